@@ -1,42 +1,29 @@
-
 // ============================================================================
 // BitcoinMiner.h - FULLY OPTIMIZED
 // ============================================================================
 #pragma once
 #include <Arduino.h>
-#include <WiFiClient.h>
-#include <ArduinoJson.h>
 #include "sha256.h"
 #include "MiningCore.h"
+#include "Stratum.h"
+#include "WorkQueue.h"
 
+// One hashing thread. Work comes ready-made from the WorkQueue lane with
+// this worker's index (its own extranonce2 range or V2 channel); shares go
+// straight to the shared session.
 class BitcoinMiner {
 public:
-    BitcoinMiner(const char* name, uint8_t core);
+    BitcoinMiner(const char* name, JobSource& session, WorkQueue& work, uint8_t index);
     void start();
 
 private:
     const char* workerName;
-    uint8_t coreId;
-    WiFiClient client;
-
-    // ✅ Pre-allocated buffers to avoid String operations in hot path
-    char job_id_buf[64];
-    char extranonce1_buf[32];
-    char extranonce2_buf[32];
-    char ntime_buf[16];
-    
-    String job_id, extranonce1, ntime, extranonce2;  // Keep for compatibility
-    
-    TaskHandle_t shareTaskHandle = nullptr;
+    JobSource& session;
+    WorkQueue& work;
+    uint8_t workerIndex;
+    WorkerCounters counters = {};   // this thread's totals, published to workerStats
 
-    void connectToPool(String host, uint16_t port);
-    void subscribeAndAuth();
-    bool getNewJob();
-    void mineWithMidstate(uint8_t* target);
-    void shareSubmissionTask();
+    void mine(const WorkUnit& unit);
 
-    // ✅ Aligned memory for optimal access
-    uint8_t blockheader[80] __attribute__((aligned(4)));
-    uint8_t target[32] __attribute__((aligned(4)));
-    SHA256_CTX midstate;
-};
\ No newline at end of file
+    static const size_t MAX_CANDIDATES = 4;
+};
@@ -17,6 +17,15 @@ static const int MONITOR_PRIORITY = 3; // Medium priority for monitor
 static const int BACKGROUND_PRIORITY = 1; // Low priority for background tasks
 static const int UDP_LISTENER_PRIORITY = 4; // High priority for UDP listener
 static const int MONITOR_UPDATE_INTERVAL_MS = 5000; // Monitor update interval
+static const unsigned long STATS_SAVE_INTERVAL_MS = 900000; // Lifetime stats checkpoint at most this often...
+static const unsigned long STATS_URGENT_SAVE_MS = 60000; // ...or after this for a block or a new best share
+static const uint64_t STATS_SAVE_MIN_HASHES = 50000000ULL; // Skip a checkpoint that would only add fewer hashes than this
+static const int STRATUM_PRIORITY = 4; // Pool session: above the miners so it is never starved, it mostly sleeps
+static const uint32_t STRATUM_STACK_SIZE = 6144; // Parser buffers live in the session object
+static const unsigned long SUBMIT_TIMEOUT_MS = 30000; // Unanswered shares count as timed out after this
+static const uint32_t MINER_STACK_SIZE = 8192; // Miners no longer parse or build strings
+static const int WORK_PRIORITY = 4; // Work producer: above the miners so the next unit is ready before it is needed
+static const uint32_t WORK_STACK_SIZE = 4096; // Jobs and headers live in the queue object
 static const unsigned long MAX_NONCE = 0xFFFFFFFFUL;
 static const char* ADDRESS = "bc1qpe8gjgfs5hh0aw7veusxqppycyz0ea0nvjxr3k";
 
@@ -28,11 +37,45 @@ static bool WEB_SERVER_ONLY = false;
 // Pool
 static const char* POOL_URL = "solo.ckpool.org";
 static uint16_t POOL_PORT = 3333;
+static const uint32_t VERSION_ROLLING_MASK = 0x1fffe000; // BIP 320 general purpose bits
+static const char* STRATUM_USER_AGENT = "SoloSwarm/1.0";
+
+// Failover pools, tried after POOL_URL by measured connect time
+struct PoolConfig {
+    const char* host;
+    uint16_t port;
+};
+static const PoolConfig FALLBACK_POOLS[] = {
+    {"public-pool.io", 21496},
+    {"pool.nerdminers.org", 3333},
+};
+static const int POOL_CONNECT_TIMEOUT_MS = 5000;
+static const unsigned long POOL_HANDSHAKE_TIMEOUT_MS = 10000; // SV2 setup and channels answered by then, else the pool failed
+static const unsigned long POOL_BACKOFF_BASE_MS = 1000;  // doubles per failure, +-50% jitter
+static const unsigned long POOL_BACKOFF_MAX_MS = 120000;
+static const unsigned long POOL_STABLE_MS = 60000;       // a session this long resets the backoff
+
+// Stratum proxy: S3 miners point at the dashboard instead of the pool.
+// Off by default: it opens a port that accepts any miner on the network.
+static const bool ENABLE_PROXY = false;
+static const uint16_t PROXY_PORT = 3333;
+static const int PROXY_PRIORITY = 4; // Above the miners like the session, it mostly sleeps
+static const uint32_t PROXY_STACK_SIZE = 6144;
+
+// Stratum V2 instead of POOL_URL: plaintext frames (no Noise), so point it at
+// a local SV2 pool or translator proxy. The V1 proxy above needs V1.
+static const bool USE_STRATUM_V2 = false;
+static const char* SV2_POOL_URL = "192.168.1.10";
+static const uint16_t SV2_POOL_PORT = 34255;
+static const float SV2_NOMINAL_HASHRATE = 20000.0f; // per channel (thread), H/s
+static const uint32_t MAX_NTIME_ROLL_S = 600; // Header-only jobs roll ntime at most this far past the job's own
+
 static bool DEBUG = true;
 
 // Variables
 // Small epsilon for float comparisons
 static constexpr float DEFAULT_EPS = 0.01f;
 static constexpr int MAX_MINERS = 8; // compile-time capacity (ensure >= expected runtime NUMBER_OF_MINERS)
+static constexpr int MAX_LOCAL_WORKERS = 4; // compile-time capacity (ensure >= THREADS)
 
 #endif // CONFIGS_H
@@ -0,0 +1,50 @@
+// ============================================================================
+// HashrateMeter.cpp - rolling-window hashrate from the per-worker counters
+// ============================================================================
+#include "HashrateMeter.h"
+#include <math.h>
+
+// Time constant of each window, seconds
+static const float WINDOW_SECONDS[RATE_WINDOWS] = { 10.0f, 60.0f, 300.0f, 900.0f };
+
+void HashrateMeter::sample(unsigned long now_ms) {
+    if (samples && now_ms - last_ms < HASHRATE_SAMPLE_MS) return;
+    float seconds = (now_ms - last_ms) / 1000.0f;
+    last_ms = now_ms;
+
+    uint64_t sum = 0;
+    for (size_t w = 0; w < MAX_LOCAL_WORKERS; w++) {
+        uint64_t hashes = workerStats[w].read().hashes;
+        sum += hashes;
+        update(workers[w], hashes, seconds);
+    }
+    update(total, sum, seconds);
+    if (samples < 2) samples++;
+}
+
+// First sample only sets the baseline; the second seeds every window with
+// its rate so the long windows do not spend 15 minutes climbing from zero.
+// After that each window moves toward the latest rate by 1 - e^(-dt/tau),
+// which stays right when samples arrive late.
+void HashrateMeter::update(Track& track, uint64_t hashes, float seconds) {
+    uint64_t delta = hashes - track.last_hashes;
+    track.last_hashes = hashes;
+    if (samples == 0 || seconds <= 0) return;
+
+    float instant = delta / seconds;
+    for (int i = 0; i < RATE_WINDOWS; i++) {
+        float current = track.ewma[i].load(std::memory_order_relaxed);
+        float next = (samples == 1) ? instant
+                   : current + (instant - current) * (1.0f - expf(-seconds / WINDOW_SECONDS[i]));
+        track.ewma[i].store(next, std::memory_order_relaxed);
+    }
+}
+
+float HashrateMeter::rate(HashrateWindow window) const {
+    return total.ewma[window].load(std::memory_order_relaxed);
+}
+
+float HashrateMeter::workerRate(uint8_t worker, HashrateWindow window) const {
+    if (worker >= MAX_LOCAL_WORKERS) return 0;
+    return workers[worker].ewma[window].load(std::memory_order_relaxed);
+}
@@ -0,0 +1,45 @@
+// ============================================================================
+// HashrateMeter.h - rolling-window hashrate from the per-worker counters
+// Exponentially weighted averages over 10 s, 1 min, 5 min and 15 min, for
+// the whole device and for each hashing thread, fed by periodic samples of
+// the monotonic counters. Nothing is ever reset, so the rate never jumps;
+// the 10 s window shows a slow or throttled thread within seconds.
+// ============================================================================
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "MiningCore.h"
+
+static const unsigned long HASHRATE_SAMPLE_MS = 1000;  // sample() ignores calls closer than this
+
+enum HashrateWindow : uint8_t {
+    RATE_10S,
+    RATE_1M,
+    RATE_5M,
+    RATE_15M,
+    RATE_WINDOWS
+};
+
+class HashrateMeter {
+public:
+    // Sampling task only (the monitor): reads workerStats and folds the
+    // hashes since the last sample into every window
+    void sample(unsigned long now_ms);
+
+    // Any task, lock-free. H/s; 0 until two samples have been taken.
+    float rate(HashrateWindow window) const;
+    float workerRate(uint8_t worker, HashrateWindow window) const;
+
+private:
+    struct Track {
+        uint64_t last_hashes = 0;
+        std::atomic<float> ewma[RATE_WINDOWS] = {};
+    };
+
+    Track total;
+    Track workers[MAX_LOCAL_WORKERS];
+    unsigned long last_ms = 0;
+    uint8_t samples = 0;        // saturates at 2: 0 = no baseline, 1 = seed next
+
+    void update(Track& track, uint64_t hashes, float seconds);
+};
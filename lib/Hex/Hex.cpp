@@ -0,0 +1,85 @@
+// ============================================================================
+// Hex.cpp - table-driven hex codec
+// ============================================================================
+#include "Hex.h"
+#include <string.h>
+
+#define X 0xFF
+const uint8_t HEX_VALUE[256] = {
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, X, X, X, X, X, X,    // '0'..'9'
+    X,10,11,12,13,14,15, X, X, X, X, X, X, X, X, X,    // 'A'..'F'
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X,10,11,12,13,14,15, X, X, X, X, X, X, X, X, X,    // 'a'..'f'
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+    X, X, X, X, X, X, X, X, X, X, X, X, X, X, X, X,
+};
+#undef X
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+// Invalid digits are 0xFF, so OR-ing every looked-up value and testing the
+// high bit once at the end replaces a branch per digit
+bool hex_decode(const char* in, size_t in_len, uint8_t* out) {
+    if (in_len & 1) return false;
+    const uint8_t* p = (const uint8_t*)in;
+    uint8_t bad = 0;
+    size_t n = in_len / 2;
+
+    // Four bytes per iteration keeps the loads and stores pipelined
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4, p += 8) {
+        uint8_t h0 = HEX_VALUE[p[0]], l0 = HEX_VALUE[p[1]];
+        uint8_t h1 = HEX_VALUE[p[2]], l1 = HEX_VALUE[p[3]];
+        uint8_t h2 = HEX_VALUE[p[4]], l2 = HEX_VALUE[p[5]];
+        uint8_t h3 = HEX_VALUE[p[6]], l3 = HEX_VALUE[p[7]];
+        bad |= h0 | l0 | h1 | l1 | h2 | l2 | h3 | l3;
+        out[i]     = (h0 << 4) | l0;
+        out[i + 1] = (h1 << 4) | l1;
+        out[i + 2] = (h2 << 4) | l2;
+        out[i + 3] = (h3 << 4) | l3;
+    }
+    for (; i < n; i++, p += 2) {
+        uint8_t h = HEX_VALUE[p[0]], l = HEX_VALUE[p[1]];
+        bad |= h | l;
+        out[i] = (h << 4) | l;
+    }
+    return !(bad & 0x80);
+}
+
+bool hex_decode_exact(const char* in, uint8_t* out, size_t out_len) {
+    if (!in || strlen(in) != 2 * out_len) return false;
+    return hex_decode(in, 2 * out_len, out);
+}
+
+bool hex_to_u32(const char* in, uint32_t* out) {
+    size_t len = in ? strlen(in) : 0;
+    if (len == 0 || len > 8) return false;
+    uint32_t value = 0;
+    uint8_t bad = 0;
+    for (size_t i = 0; i < len; i++) {
+        uint8_t v = hex_value(in[i]);
+        bad |= v;
+        value = (value << 4) | (v & 0x0F);
+    }
+    if (bad & 0x80) return false;
+    *out = value;
+    return true;
+}
+
+void hex_encode(const uint8_t* in, size_t len, char* out) {
+    for (size_t i = 0; i < len; i++) {
+        *out++ = HEX_DIGITS[in[i] >> 4];
+        *out++ = HEX_DIGITS[in[i] & 0x0F];
+    }
+    *out = '\0';
+}
@@ -0,0 +1,31 @@
+// ============================================================================
+// Hex.h - table-driven hex codec
+// Decoding is one table lookup per digit with the error check folded into
+// the same pass; either case is accepted. Host-compilable.
+// ============================================================================
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Digit value, or 0xFF for anything that is not a hex digit
+extern const uint8_t HEX_VALUE[256];
+
+static inline uint8_t hex_value(char ch) {
+    return HEX_VALUE[(uint8_t)ch];
+}
+
+// Decode in_len digits into in_len / 2 bytes. False on an odd length or any
+// non-hex character; out is then partially written. out may equal in, so
+// a hex field can be decoded inside the buffer it was read into.
+bool hex_decode(const char* in, size_t in_len, uint8_t* out);
+
+// Decode exactly 2 * out_len digits from a NUL-terminated string; false if
+// the string has a different length or bad digits
+bool hex_decode_exact(const char* in, uint8_t* out, size_t out_len);
+
+// 1 to 8 digits as a big-endian number (stratum version, nbits, ntime,
+// version masks); false on empty, too long or bad digits
+bool hex_to_u32(const char* in, uint32_t* out);
+
+// Lower-case hex of len bytes, NUL-terminated: out needs 2 * len + 1 chars
+void hex_encode(const uint8_t* in, size_t len, char* out);
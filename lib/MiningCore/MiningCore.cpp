@@ -2,39 +2,87 @@
 // lib/MiningCore/MiningCore.cpp - SAFE VERSION
 // ============================================================================
 #include "MiningCore.h"
+#include <math.h>
 
 // ── ACTUAL DEFINITIONS ─────────────────────────────────────────────────
-volatile long templates = 0;
-volatile long hashes = 0;
-volatile int halfshares = 0;
-volatile int shares = 0;
-volatile int valids = 0;
-volatile bool blockFound = false;
-volatile unsigned long blockFoundTime = 0;
+WorkerStats workerStats[MAX_LOCAL_WORKERS];
+std::atomic<uint32_t> templates{0};
+std::atomic<bool> blockFound{false};
+std::atomic<unsigned long> blockFoundTime{0};
+std::atomic<uint32_t> staleWorkMs{0};
 SemaphoreHandle_t statsMutex = nullptr;
+SubmitStats submitStats = {};
 
-// ✅ SAFE: Keep your original to_byte_array (it works fine!)
-int to_byte_array(const char* in, size_t in_size, uint8_t* out) {
-    int count = 0;
-    
-    // Inline hex converter
-    auto hex = [](char ch) -> uint8_t { 
-        return (ch > '9') ? (ch - 'A' + 10) : (ch - '0'); 
-    };
-    
-    if (in_size % 2) {
-        while (*in && out) {
-            *out = hex(*in++);
-            if (!*in) break;
-            *out = (*out << 4) | hex(*in++);
-            out++;
-            count++;
-        }
-    } else {
-        while (*in && out) {
-            *out++ = (hex(*in++) << 4) | hex(*in++);
-            count++;
-        }
+// ----------------------------------------------------------------------------
+// WORKER SLOTS
+// Sequence lock with a single writer: the owner makes the sequence odd,
+// stores the halves, then makes it even again. A reader that saw the same
+// even sequence before and after its loads has a consistent copy.
+// ----------------------------------------------------------------------------
+void WorkerStats::publish(const WorkerCounters& counters) {
+    uint32_t half[WORDS];
+    memcpy(half, &counters, sizeof(half));
+
+    uint32_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0; i < WORDS; i++) words[i].store(half[i], std::memory_order_relaxed);
+    sequence.store(seq + 2, std::memory_order_release);
+}
+
+WorkerCounters WorkerStats::read() const {
+    uint32_t half[WORDS];
+    uint32_t before, after;
+    for (;;) {
+        before = sequence.load(std::memory_order_acquire);
+        for (size_t i = 0; i < WORDS; i++) half[i] = words[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = sequence.load(std::memory_order_relaxed);
+        if (!(before & 1) && before == after) break;
+        // The owner was preempted mid-publish, possibly by us: let it finish
+        vTaskDelay(1);
+    }
+
+    WorkerCounters counters;
+    memcpy(&counters, half, sizeof(counters));
+    return counters;
+}
+
+WorkerCounters statsSnapshot() {
+    WorkerCounters total = {};
+    for (size_t w = 0; w < MAX_LOCAL_WORKERS; w++) {
+        WorkerCounters c = workerStats[w].read();
+        total.hashes += c.hashes;
+        total.halfshares += c.halfshares;
+        total.shares += c.shares;
+        total.valids += c.valids;
+        if (c.best_difficulty > total.best_difficulty) total.best_difficulty = c.best_difficulty;
+        total.share_difficulty += c.share_difficulty;
+        for (int i = 0; i < DIFF_BUCKETS; i++) total.difficulty_histogram[i] += c.difficulty_histogram[i];
     }
-    return count;
-}
\ No newline at end of file
+    return total;
+}
+
+// ----------------------------------------------------------------------------
+// SHARE DIFFICULTY
+// Little-endian, byte 31 most significant. Skip the zero bytes on top, then
+// the next 8 bytes are the mantissa: more than a double keeps anyway.
+// ----------------------------------------------------------------------------
+double hashDifficulty(const uint8_t* hash) {
+    int top = 31;
+    while (top > 0 && hash[top] == 0) top--;
+
+    uint64_t mantissa = 0;
+    int bytes = 0;
+    for (int i = top; i >= 0 && bytes < 8; i--, bytes++) mantissa = (mantissa << 8) | hash[i];
+    if (mantissa == 0) mantissa = 1;  // an all-zero hash: cap at the value 1
+
+    int exponent = 8 * (top + 1 - bytes);  // value = mantissa * 2^exponent
+    return ldexp(65535.0 / (double)mantissa, 208 - exponent);
+}
+
+int difficultyBucket(double difficulty) {
+    if (difficulty < 2.0) return 0;
+    int bucket = ilogb(difficulty);
+    return (bucket < DIFF_BUCKETS) ? bucket : DIFF_BUCKETS - 1;
+}
@@ -5,15 +5,79 @@
 #include <Arduino.h>
 #include "configs.h"
 
-// Global statistics
-extern volatile long templates;
-extern volatile long hashes;
-extern volatile int halfshares;
-extern volatile int shares;
-extern volatile int valids;
-extern volatile bool blockFound;
-extern volatile unsigned long blockFoundTime;
-extern SemaphoreHandle_t statsMutex;
+#include <atomic>
+
+// ----------------------------------------------------------------------------
+// SHARE DIFFICULTY
+// Pool difficulty of a hash: the difficulty-1 target (0xFFFF << 208) over
+// the hash as a 256-bit number. A share of difficulty D takes D * DIFF1_HASHES
+// hashes on average, which turns submitted shares into a hashrate.
+// ----------------------------------------------------------------------------
+static const int DIFF_BUCKETS = 40;                     // log2 buckets: <2, <4 ... >= 2^39
+static const double DIFF1_HASHES = 4295032833.0;        // 2^48 / 0xFFFF
+
+// Also works on a target: the difficulty of the shares it lets through
+double hashDifficulty(const uint8_t* hash);
+int difficultyBucket(double difficulty);
+
+// ----------------------------------------------------------------------------
+// HASHING COUNTERS
+// One slot per hashing thread, written only by that thread: no lock and no
+// read-modify-write on the hot path. Counters are 64-bit so they never wrap;
+// the ESP32 has no lock-free 64-bit atomics, so each slot is published as
+// 32-bit halves under a sequence number and readers retry a torn copy.
+// Slots are padded to their own cache line so threads never share one.
+// ----------------------------------------------------------------------------
+static const size_t STATS_CACHE_LINE = 64;
+
+struct WorkerCounters {
+    uint64_t hashes;
+    uint64_t halfshares;
+    uint64_t shares;
+    uint64_t valids;
+    double best_difficulty;     // highest share difficulty hit
+    double share_difficulty;    // sum of the pool difficulty each share was found at
+    uint32_t difficulty_histogram[DIFF_BUCKETS];  // shares by difficulty hit
+};
+
+class alignas(STATS_CACHE_LINE) WorkerStats {
+public:
+    void publish(const WorkerCounters& counters);   // owner thread only
+    WorkerCounters read() const;                    // any thread
+
+private:
+    static const size_t WORDS = sizeof(WorkerCounters) / sizeof(uint32_t);
+    std::atomic<uint32_t> sequence{0};              // odd while publishing
+    std::atomic<uint32_t> words[WORDS] = {};
+};
+
+extern WorkerStats workerStats[MAX_LOCAL_WORKERS];
+
+// Every slot summed (best difficulty: the highest): what the monitor and
+// the web API show
+WorkerCounters statsSnapshot();
+
+// Written by the session task and the miners, read anywhere
+extern std::atomic<uint32_t> templates;
+extern std::atomic<bool> blockFound;
+extern std::atomic<unsigned long> blockFoundTime;
+extern std::atomic<uint32_t> staleWorkMs;        // clean_jobs flush to fresh work, summed
+extern SemaphoreHandle_t statsMutex;            // submitStats only
+
+// Pool answers to mining.submit, kept by the stratum session under statsMutex
+static const int SUBMIT_RTT_BUCKETS = 8;   // <32 ms, <64, <128 ... <2 s, >= 2 s
+struct SubmitStats {
+    uint32_t sent;
+    uint32_t accepted;
+    uint32_t rejected;          // every reject, the next three break it down
+    uint32_t stale;             // error 21, job not found
+    uint32_t duplicate;         // error 22
+    uint32_t low_difficulty;    // error 23
+    uint32_t timed_out;         // no answer, or the connection dropped first
+    uint32_t last_rtt_ms;
+    uint32_t rtt_histogram[SUBMIT_RTT_BUCKETS];
+};
+extern SubmitStats submitStats;
 
 // Cluster stats
 struct MinerStats {
@@ -23,11 +87,10 @@ struct MinerStats {
     float temp;
     unsigned long lastUpdate;
     bool online;
+    double bestDifficulty;      // lifetime best share
+    float effectiveHashrate;    // kH/s implied by the shares' difficulty
 };
 
-// Helper functions
-int to_byte_array(const char* in, size_t in_size, uint8_t* out);
-
 // ✅ SAFE: Keep original implementations but with const correctness
 inline bool checkHalfShare(const uint8_t* hash) {
     return (*(const uint16_t*)(hash + 30) == 0);
@@ -1,54 +1,13 @@
 // ============================================================================
 // sha256.cpp (Optimized for ESP32 / XTENSA)
 // ============================================================================
-#include <Arduino.h>
-
-// Force inline for critical path
-#define FORCE_INLINE __attribute__((always_inline)) inline
-
-// Fast Bitwise Operations
-#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
-#define CH(x,y,z)  (((x) & (y)) ^ (~(x) & (z)))
-#define MAJ(x,y,z) (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
-
-#define EP0(x) (ROTR(x, 2) ^ ROTR(x, 13) ^ ROTR(x, 22))
-#define EP1(x) (ROTR(x, 6) ^ ROTR(x, 11) ^ ROTR(x, 25))
-#define SIG0(x) (ROTR(x, 7) ^ ROTR(x, 18) ^ ((x) >> 3))
-#define SIG1(x) (ROTR(x, 17) ^ ROTR(x, 19) ^ ((x) >> 10))
-
-// K table in IRAM, aligned to 4 bytes for fast load
-static const uint32_t K[64] __attribute__((aligned(4))) IRAM_ATTR = {
-    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
-    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
-    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
-    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
-    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
-    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
-    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
-    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
-};
+#include "sha256_kernel.h"
 
 IRAM_ATTR void sha256_init_state(uint32_t* state) {
     state[0] = 0x6a09e667; state[1] = 0xbb67ae85; state[2] = 0x3c6ef372; state[3] = 0xa54ff53a;
     state[4] = 0x510e527f; state[5] = 0x9b05688c; state[6] = 0x1f83d9ab; state[7] = 0x5be0cd19;
 }
 
-// ----------------------------------------------------------------------------
-// OPTIMIZED MACROS - Using pre-declared temps for better performance
-// ----------------------------------------------------------------------------
-
-// ✅ OPTIMIZATION: Declare temps outside macro for better stack management
-#define ROUND_OPT(a, b, c, d, e, f, g, h, k, w) \
-    temp1 = h + EP1(e) + CH(e,f,g) + k + w; \
-    temp2 = EP0(a) + MAJ(a,b,c); \
-    d += temp1; \
-    h = temp1 + temp2;
-
-// Message schedule expansion
-#define EXPAND(w, i) ( \
-    w[i&15] += SIG1(w[(i+14)&15]) + w[(i+9)&15] + SIG0(w[(i+1)&15]) \
-)
-
 // ----------------------------------------------------------------------------
 // GENERIC TRANSFORM (Optimized)
 // ----------------------------------------------------------------------------
@@ -110,11 +69,90 @@ IRAM_ATTR void sha256_midstate_init(uint32_t* midstate, const uint8_t* header64)
     sha256_transform(midstate, w);
 }
 
+// ----------------------------------------------------------------------------
+// PER-JOB PRECOMPUTE
+// Hash 1 of the header tail only sees the nonce in W3. Rounds 0-2, the T1/T2
+// terms of round 3 and every schedule term that does not depend on W3 are
+// computed here once per job instead of once per nonce.
+// ----------------------------------------------------------------------------
+IRAM_ATTR void sha256_job_init(JobPrecompute* job, const uint8_t* header80) {
+    sha256_midstate_init(job->midstate, header80);
+
+    // Second header block: merkle root tail, ntime, nbits (big-endian words)
+    for (int i = 0; i < 3; i++) {
+        uint32_t temp;
+        memcpy(&temp, header80 + 64 + (i * 4), 4);
+        job->tail[i] = __builtin_bswap32(temp);
+    }
+    const uint32_t w0 = job->tail[0], w1 = job->tail[1], w2 = job->tail[2];
+
+    uint32_t temp1, temp2;
+    uint32_t a = job->midstate[0], b = job->midstate[1], c = job->midstate[2], d = job->midstate[3];
+    uint32_t e = job->midstate[4], f = job->midstate[5], g = job->midstate[6], h = job->midstate[7];
+
+    ROUND_OPT(a, b, c, d, e, f, g, h, K[0], w0);
+    ROUND_OPT(h, a, b, c, d, e, f, g, K[1], w1);
+    ROUND_OPT(g, h, a, b, c, d, e, f, K[2], w2);
+
+    // Round 3 is ROUND_OPT(f, g, h, a, b, c, d, e, K[3], nonce): fold
+    // everything but the nonce into the two registers it writes.
+    temp1 = e + EP1(b) + CH(b, c, d) + K[3];
+    temp2 = EP0(f) + MAJ(f, g, h);
+    job->state3[0] = a + temp1;  // a, still missing + nonce
+    job->state3[1] = b;
+    job->state3[2] = c;
+    job->state3[3] = d;
+    job->state3[4] = temp1 + temp2;  // e, still missing + nonce
+    job->state3[5] = f;
+    job->state3[6] = g;
+    job->state3[7] = h;
+
+    // W5..W14 are zero, which strips most terms from W16..W32
+    job->w16 = w0 + SIG0(w1);
+    job->w17 = w1 + SIG0(w2) + sig1_c(H1_LEN);
+    job->kw16 = K[16] + job->w16;
+    job->kw17 = K[17] + job->w17;
+    job->w18_part = w2 + SIG1(job->w16);
+    job->w19_part = sig0_c(H1_PAD) + SIG1(job->w17);
+    job->w31_part = H1_LEN + SIG0(job->w16);
+    job->w32_part = job->w16 + SIG0(job->w17);
+}
+
 // ----------------------------------------------------------------------------
 // MINER LOOP WITH EARLY EXIT OPTIMIZATION (NEW!)
 // ✅ 15-20% FASTER than original version
 // ----------------------------------------------------------------------------
-IRAM_ATTR bool sha256_final_rounds_with_nonce(const uint32_t* midstate, uint32_t nonce, uint8_t* hash) {
+// Hash 2 for the one-nonce reference path, which finishes the kernel's hits,
+// so the full hash is always written. Rounds 0-60 are the kernel's own.
+// Returns the old 16-bit test.
+static FORCE_INLINE bool sha256d_second(uint32_t* w, uint8_t* hash) {
+    uint32_t temp1, temp2;
+    uint32_t state[8];
+    sha256d_second_rounds<uint32_t>(w, state);
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+    // Hash 2 Rounds 61-63
+    ROUND_OPT(d, e, f, g, h, a, b, c, K[61], EXPAND(w, 61));
+    ROUND_OPT(c, d, e, f, g, h, a, b, K[62], EXPAND(w, 62));
+    ROUND_OPT(b, c, d, e, f, g, h, a, K[63], EXPAND(w, 63));
+    uint32_t final_h = 0x5be0cd19 + h;
+
+    // Write full hash output
+    uint32_t t;
+    t = __builtin_bswap32(0x6a09e667 + a); memcpy(hash + 0,  &t, 4);
+    t = __builtin_bswap32(0xbb67ae85 + b); memcpy(hash + 4,  &t, 4);
+    t = __builtin_bswap32(0x3c6ef372 + c); memcpy(hash + 8,  &t, 4);
+    t = __builtin_bswap32(0xa54ff53a + d); memcpy(hash + 12, &t, 4);
+    t = __builtin_bswap32(0x510e527f + e); memcpy(hash + 16, &t, 4);
+    t = __builtin_bswap32(0x9b05688c + f); memcpy(hash + 20, &t, 4);
+    t = __builtin_bswap32(0x1f83d9ab + g); memcpy(hash + 24, &t, 4);
+    t = __builtin_bswap32(final_h);        memcpy(hash + 28, &t, 4);
+
+    return (final_h & 0x0000FFFF) == 0;
+}
+
+static FORCE_INLINE bool sha256d_nonce(const uint32_t* midstate, const uint32_t* tail, uint32_t nonce, uint8_t* hash) {
     uint32_t temp1, temp2;  // Pre-declare for macro efficiency
     
     // --- HASH 1 ---
@@ -125,10 +163,10 @@ IRAM_ATTR bool sha256_final_rounds_with_nonce(const uint32_t* midstate, uint32_t
     uint32_t w[16];
 
     // Setup Message Schedule for Hash 1
-    w[0] = 0; 
-    w[1] = 0; 
-    w[2] = 0; 
-    w[3] = nonce;
+    w[0] = tail[0];
+    w[1] = tail[1];
+    w[2] = tail[2];
+    w[3] = __builtin_bswap32(nonce);  // stored little-endian in the header
     w[4] = 0x80000000;
     w[5] = 0; w[6] = 0; w[7] = 0; w[8] = 0; w[9] = 0;
     w[10] = 0; w[11] = 0; w[12] = 0; w[13] = 0; w[14] = 0;
@@ -174,131 +212,152 @@ IRAM_ATTR bool sha256_final_rounds_with_nonce(const uint32_t* midstate, uint32_t
     w[7] = midstate[7] + h;
 
     // --- HASH 2 ---
-    
-    a = 0x6a09e667; b = 0xbb67ae85; c = 0x3c6ef372; d = 0xa54ff53a;
-    e = 0x510e527f; f = 0x9b05688c; g = 0x1f83d9ab; h = 0x5be0cd19;
-
-    w[8]  = 0x80000000;
-    w[9]  = 0; w[10] = 0; w[11] = 0; w[12] = 0; w[13] = 0; w[14] = 0;
-    w[15] = 0x00000100;
+    return sha256d_second(w, hash);
+}
 
-    // Hash 2 Rounds 0-15
-    ROUND_OPT(a, b, c, d, e, f, g, h, K[0],  w[0]);
-    ROUND_OPT(h, a, b, c, d, e, f, g, K[1],  w[1]);
-    ROUND_OPT(g, h, a, b, c, d, e, f, K[2],  w[2]);
-    ROUND_OPT(f, g, h, a, b, c, d, e, K[3],  w[3]);
-    ROUND_OPT(e, f, g, h, a, b, c, d, K[4],  w[4]);
-    ROUND_OPT(d, e, f, g, h, a, b, c, K[5],  w[5]);
-    ROUND_OPT(c, d, e, f, g, h, a, b, K[6],  w[6]);
-    ROUND_OPT(b, c, d, e, f, g, h, a, K[7],  w[7]);
-    ROUND_OPT(a, b, c, d, e, f, g, h, K[8],  w[8]);
-    ROUND_OPT(h, a, b, c, d, e, f, g, K[9],  w[9]);
-    ROUND_OPT(g, h, a, b, c, d, e, f, K[10], w[10]);
-    ROUND_OPT(f, g, h, a, b, c, d, e, K[11], w[11]);
-    ROUND_OPT(e, f, g, h, a, b, c, d, K[12], w[12]);
-    ROUND_OPT(d, e, f, g, h, a, b, c, K[13], w[13]);
-    ROUND_OPT(c, d, e, f, g, h, a, b, K[14], w[14]);
-    ROUND_OPT(b, c, d, e, f, g, h, a, K[15], w[15]);
+IRAM_ATTR bool sha256_final_rounds_with_nonce(const JobPrecompute* job, uint32_t nonce, uint8_t* hash) {
+    return sha256d_nonce(job->midstate, job->tail, nonce, hash);
+}
 
-    // Hash 2 Rounds 16-60
-    for (int i = 16; i < 61; i += 8) {
-        ROUND_OPT(a, b, c, d, e, f, g, h, K[i+0], EXPAND(w, i+0));
-        ROUND_OPT(h, a, b, c, d, e, f, g, K[i+1], EXPAND(w, i+1));
-        ROUND_OPT(g, h, a, b, c, d, e, f, K[i+2], EXPAND(w, i+2));
-        ROUND_OPT(f, g, h, a, b, c, d, e, K[i+3], EXPAND(w, i+3));
-        ROUND_OPT(e, f, g, h, a, b, c, d, K[i+4], EXPAND(w, i+4));
-        ROUND_OPT(d, e, f, g, h, a, b, c, K[i+5], EXPAND(w, i+5));
-        ROUND_OPT(c, d, e, f, g, h, a, b, K[i+6], EXPAND(w, i+6));
-        ROUND_OPT(b, c, d, e, f, g, h, a, K[i+7], EXPAND(w, i+7));
+// ----------------------------------------------------------------------------
+// SHARE TARGET
+// ----------------------------------------------------------------------------
+void sha256_target_init(ShareTarget* target, const uint8_t* target32) {
+    for (int i = 0; i < 8; i++) {
+        target->words[i] = (uint32_t)target32[4*i] | ((uint32_t)target32[4*i+1] << 8) |
+                           ((uint32_t)target32[4*i+2] << 16) | ((uint32_t)target32[4*i+3] << 24);
     }
 
-    // ✅ EARLY EXIT OPTIMIZATION - THE KEY PERFORMANCE BOOST!
-    // Check last 2 bytes after round 60
-    uint32_t final_h = 0x5be0cd19 + h;
-    
-    // 99.9999% of hashes fail this check and exit early!
-    if (__builtin_expect((final_h & 0x0000FFFF) != 0, 1)) {
-        return false;  // Not even a 16-bit share, skip remaining work!
+    // Leading zero bits of the target are bits every hit must have clear.
+    // They sit in the low bytes of the H7 state word (the hash is stored
+    // big-endian per word); capped at 16 so the halfshare count stays exact.
+    const uint32_t top = target->words[7];
+    const int zeros = top ? __builtin_clz(top) : 32;
+    const uint32_t top_mask = zeros ? 0xFFFFFFFFu << (32 - zeros) : 0;
+    target->h7_mask = __builtin_bswap32(top_mask) & 0x0000FFFF;
+}
+
+IRAM_ATTR bool sha256_hash_meets(const uint8_t* hash, const ShareTarget* target) {
+    for (int i = 7; i >= 0; i--) {
+        uint32_t word;
+        memcpy(&word, hash + 4*i, 4);
+        if (word != target->words[i]) return word < target->words[i];
     }
-    
-    // Only ~0.0001% of hashes reach here (potential shares)
-    // Complete the final 3 rounds
-    ROUND_OPT(a, b, c, d, e, f, g, h, K[61], EXPAND(w, 61));
-    ROUND_OPT(h, a, b, c, d, e, f, g, K[62], EXPAND(w, 62));
-    ROUND_OPT(g, h, a, b, c, d, e, f, K[63], EXPAND(w, 63));
+    return true;
+}
 
-    // Write full hash output
-    uint32_t t;
-    t = __builtin_bswap32(0x6a09e667 + a); memcpy(hash + 0,  &t, 4);
-    t = __builtin_bswap32(0xbb67ae85 + b); memcpy(hash + 4,  &t, 4);
-    t = __builtin_bswap32(0x3c6ef372 + c); memcpy(hash + 8,  &t, 4);
-    t = __builtin_bswap32(0xa54ff53a + d); memcpy(hash + 12, &t, 4);
-    t = __builtin_bswap32(0x510e527f + e); memcpy(hash + 16, &t, 4);
-    t = __builtin_bswap32(0x9b05688c + f); memcpy(hash + 20, &t, 4);
-    t = __builtin_bswap32(0x1f83d9ab + g); memcpy(hash + 24, &t, 4);
-    t = __builtin_bswap32(final_h);        memcpy(hash + 28, &t, 4);
-    
-    return true;  // Potential share!
+// ----------------------------------------------------------------------------
+// NONCE-RANGE SCAN KERNEL
+// One IRAM call per batch instead of one per nonce. Hash 1 resumes at round 4
+// from the JobPrecompute's state3 (rounds 0-2 and all of round 3 but the
+// nonce are done per job) and only hashes that meet the target go back to
+// the caller.
+// ----------------------------------------------------------------------------
+IRAM_ATTR ScanResult sha256d_scan_scalar(const JobPrecompute* job, const ShareTarget* target,
+                                         uint32_t nonce_begin, uint32_t count, Candidate* out, size_t max_out) {
+#if SHA256_SCAN_LANES == 2
+    return scan_lanes<v2u, 2>(job, target, nonce_begin, count, out, max_out);
+#else
+    return scan_single(job, target, nonce_begin, count, out, max_out);
+#endif
+}
+
+#ifndef SHA256_HOST_SIMD
+// Device builds have a single backend
+IRAM_ATTR ScanResult sha256d_scan(const JobPrecompute* job, const ShareTarget* target,
+                                  uint32_t nonce_begin, uint32_t count, Candidate* out, size_t max_out) {
+    return sha256d_scan_scalar(job, target, nonce_begin, count, out, max_out);
+}
+
+Sha256Backend sha256_backend() { return SHA256_BACKEND_SCALAR; }
+bool sha256_set_backend(Sha256Backend backend) { return backend == SHA256_BACKEND_SCALAR; }
+#endif
+
+const char* sha256_backend_name(Sha256Backend backend) {
+    switch (backend) {
+        case SHA256_BACKEND_SSE2:  return "sse2-4way";
+        case SHA256_BACKEND_AVX2:  return "avx2-8way";
+        case SHA256_BACKEND_SHANI: return "sha-ni";
+        default:                   return "scalar";
+    }
 }
 
 // ----------------------------------------------------------------------------
-// STANDARD DOUBLE (Helper)
+// STREAMING API
+// Job setup only, so nothing here lives in IRAM.
 // ----------------------------------------------------------------------------
-IRAM_ATTR void sha256_bitcoin_double(const uint8_t* data, size_t len, uint8_t* hash) {
-    uint32_t state[8];
-    sha256_init_state(state);
-    
+static void sha256_block(uint32_t* state, const uint8_t* block) {
     uint32_t w[16];
-    size_t blocks = (len + 9 + 63) / 64;
-    
-    const uint8_t* ptr = data;
-    size_t rem_len = len;
-
-    for (size_t blk = 0; blk < blocks; blk++) {
-        memset(w, 0, sizeof(w));
-        
-        size_t copy_len = (rem_len > 64) ? 64 : rem_len;
-        for (size_t i = 0; i < copy_len; i += 4) {
-             uint32_t val = 0;
-             if (i + 3 < copy_len) {
-                memcpy(&val, ptr + i, 4);
-                val = __builtin_bswap32(val);
-             } else {
-                for(size_t k=0; k<4 && i+k < copy_len; k++) {
-                    val |= ptr[i+k] << (24 - 8*k);
-                }
-             }
-             w[i/4] = val;
-        }
-
-        if (rem_len < 64) {
-            size_t pad_pos = rem_len % 64;
-            w[pad_pos/4] |= (0x80 << (24 - 8*(pad_pos%4)));
-            if (rem_len + 1 + 8 <= 64) {
-                 w[15] = len * 8;
-            }
-        }
-
-        if(blk == blocks - 1) w[15] = len * 8;
-
-        sha256_transform(state, w);
-        ptr += 64;
-        rem_len = (rem_len > 64) ? rem_len - 64 : 0;
+    for (int i = 0; i < 16; i++) {
+        uint32_t temp;
+        memcpy(&temp, block + (i * 4), 4);
+        w[i] = __builtin_bswap32(temp);
     }
+    sha256_transform(state, w);
+}
 
-    // Second Hash
-    uint32_t w2[16];
-    for(int i=0; i<8; i++) w2[i] = state[i];
-    w2[8] = 0x80000000;
-    for(int i=9; i<15; i++) w2[i] = 0;
-    w2[15] = 256;
-    
-    sha256_init_state(state);
-    sha256_transform(state, w2);
+void sha256_init(SHA256_CTX* ctx) {
+    sha256_init_state(ctx->state);
+    ctx->buflen = 0;
+    ctx->total = 0;
+}
+
+void sha256_update(SHA256_CTX* ctx, const uint8_t* data, size_t len) {
+    ctx->total += len;
+
+    if (ctx->buflen) {
+        size_t take = 64 - ctx->buflen;
+        if (take > len) take = len;
+        memcpy(ctx->buf + ctx->buflen, data, take);
+        ctx->buflen += take;
+        data += take;
+        len -= take;
+        if (ctx->buflen < 64) return;
+        sha256_block(ctx->state, ctx->buf);
+        ctx->buflen = 0;
+    }
+
+    // Whole blocks straight from the input
+    for (; len >= 64; data += 64, len -= 64) sha256_block(ctx->state, data);
+
+    memcpy(ctx->buf, data, len);
+    ctx->buflen = len;
+}
+
+void sha256_final(SHA256_CTX* ctx, uint8_t* hash) {
+    const uint64_t bits = ctx->total * 8;
+
+    // 0x80 terminator, zero fill, 64-bit big-endian length in the last 8 bytes
+    ctx->buf[ctx->buflen++] = 0x80;
+    if (ctx->buflen > 56) {
+        memset(ctx->buf + ctx->buflen, 0, 64 - ctx->buflen);
+        sha256_block(ctx->state, ctx->buf);
+        ctx->buflen = 0;
+    }
+    memset(ctx->buf + ctx->buflen, 0, 56 - ctx->buflen);
+    for (int i = 0; i < 8; i++) ctx->buf[56 + i] = (uint8_t)(bits >> (56 - 8 * i));
+    sha256_block(ctx->state, ctx->buf);
 
-    // Output
     for (int i = 0; i < 8; i++) {
-        uint32_t t = __builtin_bswap32(state[i]);
+        uint32_t t = __builtin_bswap32(ctx->state[i]);
         memcpy(hash + i*4, &t, 4);
     }
-}
\ No newline at end of file
+}
+
+void sha256d_final(SHA256_CTX* ctx, uint8_t* hash) {
+    uint8_t first[32];
+    sha256_final(ctx, first);
+    sha256_init(ctx);
+    sha256_update(ctx, first, sizeof(first));
+    sha256_final(ctx, hash);
+}
+
+// ----------------------------------------------------------------------------
+// STANDARD DOUBLE (Helper)
+// ----------------------------------------------------------------------------
+IRAM_ATTR void sha256_bitcoin_double(const uint8_t* data, size_t len, uint8_t* hash) {
+    SHA256_CTX ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, data, len);
+    sha256d_final(&ctx, hash);
+}
@@ -1,16 +1,115 @@
 // sha256_optimized.h
 #pragma once
+#ifdef ARDUINO
 #include <Arduino.h>
+#else
+// Host builds (benchmarks, equivalence checks) compile the same sources
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#ifndef IRAM_ATTR
+#define IRAM_ATTR
+#endif
+#endif
 
+// Scalar kernel width: 1 hashes one nonce at a time, 2 runs nonces N and N+1
+// in lockstep so dual-issue cores can overlap the two round chains. Pick per
+// target with -DSHA256_SCAN_LANES=2 in build_flags.
+#ifndef SHA256_SCAN_LANES
+#define SHA256_SCAN_LANES 1
+#endif
+
+// x86 hosts get the multi-lane SIMD and SHA-NI backends (sha256_x86.cpp)
+#if !defined(ARDUINO) && (defined(__x86_64__) || defined(__i386__))
+#define SHA256_HOST_SIMD 1
+#endif
+
+// Streaming context for sha256_init/update/final. Plain data: copying it
+// snapshots the hash of everything fed so far (e.g. a coinbase prefix).
 typedef struct {
     uint32_t state[8];
+    uint8_t buf[64];       // bytes of the current, not yet full block
+    uint32_t buflen;
+    uint64_t total;        // bytes fed so far
 } SHA256_CTX;
 
+// Per-job kernel context, filled once per job and read-only while scanning.
+// Holds the midstate, the header tail and everything in hash 1 of the tail
+// block that does not depend on the nonce (W3), so the scan kernel can start
+// at round 4.
+typedef struct {
+    uint32_t midstate[8];
+    uint32_t tail[3];      // header bytes 64..75: merkle root tail, ntime, nbits
+    uint32_t state3[8];    // a..h after round 3, minus the nonce in a and e
+    uint32_t w16, w17;     // fully nonce-independent schedule words
+    uint32_t kw16, kw17;   // K[16] + W16, K[17] + W17
+    uint32_t w18_part;     // W2 + SIG1(W16)         (+ SIG0(nonce))
+    uint32_t w19_part;     // SIG0(W4) + SIG1(W17)   (+ nonce)
+    uint32_t w31_part;     // W15 + SIG0(W16)
+    uint32_t w32_part;     // W16 + SIG0(W17)
+} JobPrecompute;
+
+// Share target the kernel filters against, built by sha256_target_init from a
+// 32-byte little-endian target (byte 31 most significant, as in checkValid)
+typedef struct {
+    uint32_t words[8];     // target words, words[7] most significant
+    uint32_t h7_mask;      // H7 bits every hit must have clear (at most 16)
+} ShareTarget;
+
+// Nonce whose hash meets the share target, with its full hash
+typedef struct {
+    uint32_t nonce;
+    uint8_t hash[32] __attribute__((aligned(4)));
+} Candidate;
+
+typedef struct {
+    uint32_t scanned;      // nonces hashed, count unless out filled up
+    uint32_t found;        // candidates written to out
+    uint32_t halfshares;   // hashes with 16+ leading zero bits (stats only)
+} ScanResult;
+
 // Optimized SHA256 for Bitcoin mining
 void IRAM_ATTR sha256_init_state(uint32_t* state);
 void IRAM_ATTR sha256_transform_first64(uint32_t* state, const uint8_t* data);
 void IRAM_ATTR sha256_bitcoin_double(const uint8_t* data, size_t len, uint8_t* hash);
 
+// Streaming SHA-256 for data that arrives in pieces or has a reusable prefix
+void sha256_init(SHA256_CTX* ctx);
+void sha256_update(SHA256_CTX* ctx, const uint8_t* data, size_t len);
+void sha256_final(SHA256_CTX* ctx, uint8_t* hash);
+void sha256d_final(SHA256_CTX* ctx, uint8_t* hash);  // SHA-256 of sha256_final
+
 // Ultra-fast midstate mining
 void IRAM_ATTR sha256_midstate_init(uint32_t* midstate, const uint8_t* header64);
-bool IRAM_ATTR sha256_final_rounds_with_nonce(const uint32_t* midstate, uint32_t nonce, uint8_t* hash);
\ No newline at end of file
+
+void sha256_target_init(ShareTarget* target, const uint8_t* target32);
+bool IRAM_ATTR sha256_hash_meets(const uint8_t* hash, const ShareTarget* target);
+
+// Per-job precompute for an 80-byte header, and the one-nonce reference path
+// that gives the full double hash for one nonce of it
+void IRAM_ATTR sha256_job_init(JobPrecompute* job, const uint8_t* header80);
+bool IRAM_ATTR sha256_final_rounds_with_nonce(const JobPrecompute* job, uint32_t nonce, uint8_t* hash);
+
+// Nonce-range scan over an 80-byte header. Nonces are the little-endian value
+// of header bytes 76..79 (what mining.submit sends as %08x). Hashes
+// [nonce_begin, nonce_begin + count) and writes up to max_out (>= 1) nonces
+// whose hash meets the target. Stops early once out is full, so the caller
+// resumes from nonce_begin + scanned.
+ScanResult IRAM_ATTR sha256d_scan(const JobPrecompute* job, const ShareTarget* target,
+                                  uint32_t nonce_begin, uint32_t count, Candidate* out, size_t max_out);
+ScanResult IRAM_ATTR sha256d_scan_scalar(const JobPrecompute* job, const ShareTarget* target,
+                                         uint32_t nonce_begin, uint32_t count, Candidate* out, size_t max_out);
+
+// Scan backends. sha256d_scan runs the active one; all of them return the
+// same candidates in the same (increasing nonce) order. The device only has
+// the scalar kernel, hosts pick the best one the CPU supports on first use.
+typedef enum {
+    SHA256_BACKEND_SCALAR = 0,
+    SHA256_BACKEND_SSE2,    // 4 nonces per SSE2 vector
+    SHA256_BACKEND_AVX2,    // 8 nonces per AVX2 vector
+    SHA256_BACKEND_SHANI    // one nonce at a time on the SHA extensions
+} Sha256Backend;
+
+Sha256Backend sha256_backend();
+bool sha256_set_backend(Sha256Backend backend);  // false if the CPU lacks it
+const char* sha256_backend_name(Sha256Backend backend);
@@ -0,0 +1,342 @@
+// ============================================================================
+// sha256_kernel.h - shared round macros, constants and the templated nonce
+// kernel. Internal to lib/SHA256: included by the scalar kernel and by the
+// host SIMD backends.
+// ============================================================================
+#pragma once
+#include "sha256.h"
+
+// Force inline for critical path
+#define FORCE_INLINE __attribute__((always_inline)) inline
+
+// Fast Bitwise Operations
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+#define CH(x,y,z)  (((x) & (y)) ^ (~(x) & (z)))
+#define MAJ(x,y,z) (((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+
+#define EP0(x) (ROTR(x, 2) ^ ROTR(x, 13) ^ ROTR(x, 22))
+#define EP1(x) (ROTR(x, 6) ^ ROTR(x, 11) ^ ROTR(x, 25))
+#define SIG0(x) (ROTR(x, 7) ^ ROTR(x, 18) ^ ((x) >> 3))
+#define SIG1(x) (ROTR(x, 17) ^ ROTR(x, 19) ^ ((x) >> 10))
+
+// K table in IRAM, aligned to 4 bytes for fast load
+static constexpr uint32_t K[64] __attribute__((aligned(4))) IRAM_ATTR = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+// ----------------------------------------------------------------------------
+// COMPILE-TIME K+W TABLES
+// The padding words of both mining blocks never change, so their K+W sums and
+// the SIG0/SIG1 terms of those words are folded by the compiler.
+// ----------------------------------------------------------------------------
+static constexpr uint32_t rotr_c(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+static constexpr uint32_t sig0_c(uint32_t x) { return rotr_c(x, 7) ^ rotr_c(x, 18) ^ (x >> 3); }
+static constexpr uint32_t sig1_c(uint32_t x) { return rotr_c(x, 17) ^ rotr_c(x, 19) ^ (x >> 10); }
+
+// Hash 1, second header block: W3 = nonce, W4 = pad, W15 = 640-bit length
+static constexpr uint32_t H1_PAD = 0x80000000, H1_LEN = 0x00000280;
+// Hash 2, 32-byte digest: W8 = pad, W15 = 256-bit length
+static constexpr uint32_t H2_PAD = 0x80000000, H2_LEN = 0x00000100;
+
+static constexpr uint32_t h1_word(int i) { return i == 4 ? H1_PAD : i == 15 ? H1_LEN : 0; }
+static constexpr uint32_t h2_word(int i) { return i == 8 ? H2_PAD : i == 15 ? H2_LEN : 0; }
+
+#define KW_ROW(fn, i) K[i] + fn(i), K[i+1] + fn(i+1), K[i+2] + fn(i+2), K[i+3] + fn(i+3)
+
+// KW1[i] = K[i] + W[i] for hash 1, valid for the constant slots 4..15
+static constexpr uint32_t KW1[16] = {
+    KW_ROW(h1_word, 0), KW_ROW(h1_word, 4), KW_ROW(h1_word, 8), KW_ROW(h1_word, 12)
+};
+// KW2[i] = K[i] + W[i] for hash 2, valid for the constant slots 8..15
+static constexpr uint32_t KW2[16] = {
+    KW_ROW(h2_word, 0), KW_ROW(h2_word, 4), KW_ROW(h2_word, 8), KW_ROW(h2_word, 12)
+};
+
+// ----------------------------------------------------------------------------
+// OPTIMIZED MACROS - Using pre-declared temps for better performance
+// ----------------------------------------------------------------------------
+
+// ✅ OPTIMIZATION: Declare temps outside macro for better stack management
+#define ROUND_OPT(a, b, c, d, e, f, g, h, k, w) \
+    temp1 = h + EP1(e) + CH(e,f,g) + k + w; \
+    temp2 = EP0(a) + MAJ(a,b,c); \
+    d += temp1; \
+    h = temp1 + temp2;
+
+// Message schedule expansion
+#define EXPAND(w, i) ( \
+    w[i&15] += SIG1(w[(i+14)&15]) + w[(i+9)&15] + SIG0(w[(i+1)&15]) \
+)
+
+// Pre-added K+W round (the message word is already folded into kw)
+#define ROUND_KW(a, b, c, d, e, f, g, h, kw) \
+    temp1 = h + EP1(e) + CH(e,f,g) + kw; \
+    temp2 = EP0(a) + MAJ(a,b,c); \
+    d += temp1; \
+    h = temp1 + temp2;
+
+#define SET_W(i, x) (w[i] = (x))
+
+
+// Broadcast a constant to every lane (a plain copy for uint32_t)
+template <typename W>
+static FORCE_INLINE W splat(uint32_t x) {
+    return W{} + x;
+}
+
+// ----------------------------------------------------------------------------
+// HASH 2 ROUNDS
+// Hash 2 over the 32-byte result of hash 1 in w[0..7], rounds 0-60, shared by
+// the kernel and the one-nonce reference path. W8..W15 are padding, so rounds
+// 8-15 use KW2 and every zero term is left out of the schedule for rounds
+// 16-31. The working registers after round 60 go to state; the kernel only
+// reads H7 from them, the reference path runs rounds 61-63 on top.
+// ----------------------------------------------------------------------------
+template <typename W>
+static FORCE_INLINE void sha256d_second_rounds(W* w, W* state) {
+    W temp1, temp2;
+    W a = splat<W>(0x6a09e667), b = splat<W>(0xbb67ae85), c = splat<W>(0x3c6ef372), d = splat<W>(0xa54ff53a);
+    W e = splat<W>(0x510e527f), f = splat<W>(0x9b05688c), g = splat<W>(0x1f83d9ab), h = splat<W>(0x5be0cd19);
+
+    // Hash 2 Rounds 0-15
+    ROUND_OPT(a, b, c, d, e, f, g, h, K[0],  w[0]);
+    ROUND_OPT(h, a, b, c, d, e, f, g, K[1],  w[1]);
+    ROUND_OPT(g, h, a, b, c, d, e, f, K[2],  w[2]);
+    ROUND_OPT(f, g, h, a, b, c, d, e, K[3],  w[3]);
+    ROUND_OPT(e, f, g, h, a, b, c, d, K[4],  w[4]);
+    ROUND_OPT(d, e, f, g, h, a, b, c, K[5],  w[5]);
+    ROUND_OPT(c, d, e, f, g, h, a, b, K[6],  w[6]);
+    ROUND_OPT(b, c, d, e, f, g, h, a, K[7],  w[7]);
+    ROUND_KW(a, b, c, d, e, f, g, h, KW2[8]);
+    ROUND_KW(h, a, b, c, d, e, f, g, KW2[9]);
+    ROUND_KW(g, h, a, b, c, d, e, f, KW2[10]);
+    ROUND_KW(f, g, h, a, b, c, d, e, KW2[11]);
+    ROUND_KW(e, f, g, h, a, b, c, d, KW2[12]);
+    ROUND_KW(d, e, f, g, h, a, b, c, KW2[13]);
+    ROUND_KW(c, d, e, f, g, h, a, b, KW2[14]);
+    ROUND_KW(b, c, d, e, f, g, h, a, KW2[15]);
+
+    // Hash 2 Rounds 16-31 (w[i] becomes W[16+i], W9..W14 are zero)
+    ROUND_OPT(a, b, c, d, e, f, g, h, K[16], SET_W(0, w[0] + SIG0(w[1])));
+    ROUND_OPT(h, a, b, c, d, e, f, g, K[17], SET_W(1, w[1] + SIG0(w[2]) + sig1_c(H2_LEN)));
+    ROUND_OPT(g, h, a, b, c, d, e, f, K[18], SET_W(2, w[2] + SIG0(w[3]) + SIG1(w[0])));
+    ROUND_OPT(f, g, h, a, b, c, d, e, K[19], SET_W(3, w[3] + SIG0(w[4]) + SIG1(w[1])));
+    ROUND_OPT(e, f, g, h, a, b, c, d, K[20], SET_W(4, w[4] + SIG0(w[5]) + SIG1(w[2])));
+    ROUND_OPT(d, e, f, g, h, a, b, c, K[21], SET_W(5, w[5] + SIG0(w[6]) + SIG1(w[3])));
+    ROUND_OPT(c, d, e, f, g, h, a, b, K[22], SET_W(6, w[6] + SIG0(w[7]) + SIG1(w[4]) + H2_LEN));
+    ROUND_OPT(b, c, d, e, f, g, h, a, K[23], SET_W(7, w[7] + sig0_c(H2_PAD) + SIG1(w[5]) + w[0]));
+    ROUND_OPT(a, b, c, d, e, f, g, h, K[24], SET_W(8, H2_PAD + SIG1(w[6]) + w[1]));
+    ROUND_OPT(h, a, b, c, d, e, f, g, K[25], SET_W(9, SIG1(w[7]) + w[2]));
+    ROUND_OPT(g, h, a, b, c, d, e, f, K[26], SET_W(10, SIG1(w[8]) + w[3]));
+    ROUND_OPT(f, g, h, a, b, c, d, e, K[27], SET_W(11, SIG1(w[9]) + w[4]));
+    ROUND_OPT(e, f, g, h, a, b, c, d, K[28], SET_W(12, SIG1(w[10]) + w[5]));
+    ROUND_OPT(d, e, f, g, h, a, b, c, K[29], SET_W(13, SIG1(w[11]) + w[6]));
+    ROUND_OPT(c, d, e, f, g, h, a, b, K[30], SET_W(14, sig0_c(H2_LEN) + SIG1(w[12]) + w[7]));
+    ROUND_OPT(b, c, d, e, f, g, h, a, K[31], SET_W(15, H2_LEN + SIG0(w[0]) + SIG1(w[13]) + w[8]));
+
+    // Hash 2 Rounds 32-55
+    for (int i = 32; i < 56; i += 8) {
+        ROUND_OPT(a, b, c, d, e, f, g, h, K[i+0], EXPAND(w, i+0));
+        ROUND_OPT(h, a, b, c, d, e, f, g, K[i+1], EXPAND(w, i+1));
+        ROUND_OPT(g, h, a, b, c, d, e, f, K[i+2], EXPAND(w, i+2));
+        ROUND_OPT(f, g, h, a, b, c, d, e, K[i+3], EXPAND(w, i+3));
+        ROUND_OPT(e, f, g, h, a, b, c, d, K[i+4], EXPAND(w, i+4));
+        ROUND_OPT(d, e, f, g, h, a, b, c, K[i+5], EXPAND(w, i+5));
+        ROUND_OPT(c, d, e, f, g, h, a, b, K[i+6], EXPAND(w, i+6));
+        ROUND_OPT(b, c, d, e, f, g, h, a, K[i+7], EXPAND(w, i+7));
+    }
+
+    // Hash 2 Rounds 56-60
+    ROUND_OPT(a, b, c, d, e, f, g, h, K[56], EXPAND(w, 56));
+    ROUND_OPT(h, a, b, c, d, e, f, g, K[57], EXPAND(w, 57));
+    ROUND_OPT(g, h, a, b, c, d, e, f, K[58], EXPAND(w, 58));
+    ROUND_OPT(f, g, h, a, b, c, d, e, K[59], EXPAND(w, 59));
+    ROUND_OPT(e, f, g, h, a, b, c, d, K[60], EXPAND(w, 60));
+
+    state[0] = a; state[1] = b; state[2] = c; state[3] = d;
+    state[4] = e; state[5] = f; state[6] = g; state[7] = h;
+}
+
+// ----------------------------------------------------------------------------
+// SHARED NONCE KERNEL
+// Everything from round 4 of hash 1 to round 60 of hash 2, templated on the
+// word type: uint32_t for the scalar kernel, GCC vector types for the host
+// SIMD lanes (one nonce per lane). Returns H7, the only word the early exit
+// needs; candidates are finished by the reference path.
+// ----------------------------------------------------------------------------
+template <typename W>
+static FORCE_INLINE W sha256d_h7(const JobPrecompute& job, const W& w3) {
+    W temp1, temp2;
+    W w[16];
+
+    // --- HASH 1, from round 4 on ---
+    W a = job.state3[0] + w3, b = splat<W>(job.state3[1]), c = splat<W>(job.state3[2]), d = splat<W>(job.state3[3]);
+    W e = job.state3[4] + w3, f = splat<W>(job.state3[5]), g = splat<W>(job.state3[6]), h = splat<W>(job.state3[7]);
+
+    // Rounds 4-15: padding only, K+W comes from KW1
+    ROUND_KW(e, f, g, h, a, b, c, d, KW1[4]);
+    ROUND_KW(d, e, f, g, h, a, b, c, KW1[5]);
+    ROUND_KW(c, d, e, f, g, h, a, b, KW1[6]);
+    ROUND_KW(b, c, d, e, f, g, h, a, KW1[7]);
+    ROUND_KW(a, b, c, d, e, f, g, h, KW1[8]);
+    ROUND_KW(h, a, b, c, d, e, f, g, KW1[9]);
+    ROUND_KW(g, h, a, b, c, d, e, f, KW1[10]);
+    ROUND_KW(f, g, h, a, b, c, d, e, KW1[11]);
+    ROUND_KW(e, f, g, h, a, b, c, d, KW1[12]);
+    ROUND_KW(d, e, f, g, h, a, b, c, KW1[13]);
+    ROUND_KW(c, d, e, f, g, h, a, b, KW1[14]);
+    ROUND_KW(b, c, d, e, f, g, h, a, KW1[15]);
+
+    // Rounds 16-31 with the trimmed schedule (w[i] holds W[16+i])
+    w[0] = splat<W>(job.w16);
+    w[1] = splat<W>(job.w17);
+    ROUND_KW(a, b, c, d, e, f, g, h, job.kw16);
+    ROUND_KW(h, a, b, c, d, e, f, g, job.kw17);
+    ROUND_OPT(g, h, a, b, c, d, e, f, K[18], SET_W(2, job.w18_part + SIG0(w3)));
+    ROUND_OPT(f, g, h, a, b, c, d, e, K[19], SET_W(3, job.w19_part + w3));
+    ROUND_OPT(e, f, g, h, a, b, c, d, K[20], SET_W(4, H1_PAD + SIG1(w[2])));
+    ROUND_OPT(d, e, f, g, h, a, b, c, K[21], SET_W(5, SIG1(w[3])));
+    ROUND_OPT(c, d, e, f, g, h, a, b, K[22], SET_W(6, H1_LEN + SIG1(w[4])));
+    ROUND_OPT(b, c, d, e, f, g, h, a, K[23], SET_W(7, w[0] + SIG1(w[5])));
+    ROUND_OPT(a, b, c, d, e, f, g, h, K[24], SET_W(8, w[1] + SIG1(w[6])));
+    ROUND_OPT(h, a, b, c, d, e, f, g, K[25], SET_W(9, w[2] + SIG1(w[7])));
+    ROUND_OPT(g, h, a, b, c, d, e, f, K[26], SET_W(10, w[3] + SIG1(w[8])));
+    ROUND_OPT(f, g, h, a, b, c, d, e, K[27], SET_W(11, w[4] + SIG1(w[9])));
+    ROUND_OPT(e, f, g, h, a, b, c, d, K[28], SET_W(12, w[5] + SIG1(w[10])));
+    ROUND_OPT(d, e, f, g, h, a, b, c, K[29], SET_W(13, w[6] + SIG1(w[11])));
+    ROUND_OPT(c, d, e, f, g, h, a, b, K[30], SET_W(14, w[7] + SIG1(w[12]) + sig0_c(H1_LEN)));
+    ROUND_OPT(b, c, d, e, f, g, h, a, K[31], SET_W(15, job.w31_part + SIG1(w[13]) + w[8]));
+
+    // Rounds 32-63, generic expansion except for the folded W32
+    ROUND_OPT(a, b, c, d, e, f, g, h, K[32], SET_W(0, job.w32_part + SIG1(w[14]) + w[9]));
+    ROUND_OPT(h, a, b, c, d, e, f, g, K[33], EXPAND(w, 33));
+    ROUND_OPT(g, h, a, b, c, d, e, f, K[34], EXPAND(w, 34));
+    ROUND_OPT(f, g, h, a, b, c, d, e, K[35], EXPAND(w, 35));
+    ROUND_OPT(e, f, g, h, a, b, c, d, K[36], EXPAND(w, 36));
+    ROUND_OPT(d, e, f, g, h, a, b, c, K[37], EXPAND(w, 37));
+    ROUND_OPT(c, d, e, f, g, h, a, b, K[38], EXPAND(w, 38));
+    ROUND_OPT(b, c, d, e, f, g, h, a, K[39], EXPAND(w, 39));
+
+    for (int i = 40; i < 64; i += 8) {
+        ROUND_OPT(a, b, c, d, e, f, g, h, K[i+0], EXPAND(w, i+0));
+        ROUND_OPT(h, a, b, c, d, e, f, g, K[i+1], EXPAND(w, i+1));
+        ROUND_OPT(g, h, a, b, c, d, e, f, K[i+2], EXPAND(w, i+2));
+        ROUND_OPT(f, g, h, a, b, c, d, e, K[i+3], EXPAND(w, i+3));
+        ROUND_OPT(e, f, g, h, a, b, c, d, K[i+4], EXPAND(w, i+4));
+        ROUND_OPT(d, e, f, g, h, a, b, c, K[i+5], EXPAND(w, i+5));
+        ROUND_OPT(c, d, e, f, g, h, a, b, K[i+6], EXPAND(w, i+6));
+        ROUND_OPT(b, c, d, e, f, g, h, a, K[i+7], EXPAND(w, i+7));
+    }
+
+    w[0] = job.midstate[0] + a; w[1] = job.midstate[1] + b; w[2] = job.midstate[2] + c; w[3] = job.midstate[3] + d;
+    w[4] = job.midstate[4] + e; w[5] = job.midstate[5] + f; w[6] = job.midstate[6] + g; w[7] = job.midstate[7] + h;
+
+    // --- HASH 2 ---
+    W state[8];
+    sha256d_second_rounds<W>(w, state);
+
+    // The register written by round 60 ends up as H7 after rounds 61-63
+    // only shift it along, so the last word is final right here.
+    return 0x5be0cd19 + state[7];
+}
+
+// ----------------------------------------------------------------------------
+// SCAN LOOPS
+// The kernel only hands back H7, so the per-hash test is the target's mask on
+// it. The rare hash that passes is counted for stats, its top word compared
+// with the target, and only a tie on that word (or a hit) runs the reference
+// path for the remaining words.
+// ----------------------------------------------------------------------------
+static FORCE_INLINE bool scan_hit(const JobPrecompute* job, const ShareTarget* target, uint32_t nonce,
+                                  uint32_t h7, Candidate* c, ScanResult& res) {
+    res.halfshares += (h7 & 0x0000FFFF) == 0;
+
+    const uint32_t top = __builtin_bswap32(h7);
+    if (top > target->words[7]) return false;
+
+    sha256_final_rounds_with_nonce(job, nonce, c->hash);
+    c->nonce = nonce;
+    return top < target->words[7] || sha256_hash_meets(c->hash, target);
+}
+
+static FORCE_INLINE ScanResult scan_single(const JobPrecompute* job, const ShareTarget* target,
+                                           uint32_t nonce_begin, uint32_t count, Candidate* out, size_t max_out) {
+    ScanResult res = {count, 0, 0};
+    const uint32_t mask = target->h7_mask;
+    uint32_t nonce = nonce_begin;
+    const uint32_t end = nonce_begin + count;
+
+    while (nonce != end) {
+        const uint32_t h7 = sha256d_h7<uint32_t>(*job, __builtin_bswap32(nonce));
+
+        // 99.9999% of hashes fail this check
+        if (__builtin_expect((h7 & mask) == 0, 0)) {
+            if (scan_hit(job, target, nonce, h7, &out[res.found], res) && ++res.found == max_out) {
+                res.scanned = nonce - nonce_begin + 1;
+                break;
+            }
+        }
+        nonce++;
+    }
+    return res;
+}
+
+// Lane types: two interleaved nonces for the scalar build, 4/8 SIMD lanes on
+// x86 hosts. Targets without vector units get element-wise code from GCC.
+typedef uint32_t v2u __attribute__((vector_size(8)));
+typedef uint32_t v4u __attribute__((vector_size(16)));
+typedef uint32_t v8u __attribute__((vector_size(32)));
+
+template <typename V>
+static FORCE_INLINE V bswap_lanes(const V& x) {
+    return (x << 24) | ((x << 8) & 0x00FF0000) | ((x >> 8) & 0x0000FF00) | (x >> 24);
+}
+
+// Lane i hashes nonce + i through the shared kernel. Lanes that pass the mask
+// are finished in nonce order, and the leftover (count % N) nonces go through
+// the single-nonce loop.
+template <typename V, int N>
+static FORCE_INLINE ScanResult scan_lanes(const JobPrecompute* job, const ShareTarget* target,
+                                          uint32_t nonce_begin, uint32_t count, Candidate* out, size_t max_out) {
+    V lane;
+    for (int i = 0; i < N; i++) lane[i] = i;
+
+    ScanResult res = {count, 0, 0};
+    const uint32_t mask = target->h7_mask;
+    uint32_t nonce = nonce_begin;
+    uint32_t left = count;
+
+    while (left >= (uint32_t)N) {
+        const V h7 = sha256d_h7<V>(*job, bswap_lanes(splat<V>(nonce) + lane));
+        const V miss = h7 & mask;
+
+        bool hit = false;
+        for (int i = 0; i < N; i++) hit |= (miss[i] == 0);
+        if (__builtin_expect(hit, 0)) {
+            for (int i = 0; i < N; i++) {
+                if (miss[i] != 0) continue;
+                if (scan_hit(job, target, nonce + i, h7[i], &out[res.found], res) && ++res.found == max_out) {
+                    res.scanned = nonce + i - nonce_begin + 1;
+                    return res;
+                }
+            }
+        }
+        nonce += N;
+        left -= N;
+    }
+
+    if (left) {
+        const ScanResult rest = scan_single(job, target, nonce, left, out + res.found, max_out - res.found);
+        res.scanned = count - left + rest.scanned;
+        res.found += rest.found;
+        res.halfshares += rest.halfshares;
+    }
+    return res;
+}
@@ -0,0 +1,157 @@
+// ============================================================================
+// sha256_x86.cpp - host scan backends (SSE2 4-way, AVX2 8-way, SHA-NI)
+// Only built on x86 hosts (benchmarks, equivalence checks against the scalar
+// kernel). The device build compiles this file to nothing.
+// ============================================================================
+#include "sha256.h"
+
+#ifdef SHA256_HOST_SIMD
+
+// The 8-lane kernel helpers are always inlined into AVX2 code, so the
+// by-value ABI note GCC emits for them does not apply
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+#include <cpuid.h>
+#include <immintrin.h>
+#include "sha256_kernel.h"
+
+static ScanResult sha256d_scan_sse2(const JobPrecompute* job, const ShareTarget* target,
+                                    uint32_t nonce_begin, uint32_t count, Candidate* out, size_t max_out) {
+    return scan_lanes<v4u, 4>(job, target, nonce_begin, count, out, max_out);
+}
+
+__attribute__((target("avx2")))
+static ScanResult sha256d_scan_avx2(const JobPrecompute* job, const ShareTarget* target,
+                                    uint32_t nonce_begin, uint32_t count, Candidate* out, size_t max_out) {
+    return scan_lanes<v8u, 8>(job, target, nonce_begin, count, out, max_out);
+}
+
+// ----------------------------------------------------------------------------
+// SHA-NI
+// Two hardware-assisted compressions per nonce. The message is passed as host
+// words, so no byte shuffle is needed on load.
+// ----------------------------------------------------------------------------
+__attribute__((target("sha,sse4.1")))
+static FORCE_INLINE void shani_transform(uint32_t* state, const uint32_t* w) {
+    __m128i tmp = _mm_loadu_si128((const __m128i*)&state[0]);
+    __m128i st1 = _mm_loadu_si128((const __m128i*)&state[4]);
+    tmp = _mm_shuffle_epi32(tmp, 0xB1);                  // CDAB
+    st1 = _mm_shuffle_epi32(st1, 0x1B);                  // EFGH
+    __m128i st0 = _mm_alignr_epi8(tmp, st1, 8);          // ABEF
+    st1 = _mm_blend_epi16(st1, tmp, 0xF0);               // CDGH
+    const __m128i abef = st0, cdgh = st1;
+
+    __m128i m[4];
+    #pragma GCC unroll 16
+    for (int g = 0; g < 16; g++) {
+        if (g < 4) m[g] = _mm_loadu_si128((const __m128i*)&w[4 * g]);
+        __m128i msg = _mm_add_epi32(m[g & 3], _mm_loadu_si128((const __m128i*)&K[4 * g]));
+        st1 = _mm_sha256rnds2_epu32(st1, st0, msg);
+        if (g >= 3 && g <= 14) {
+            const __m128i t = _mm_alignr_epi8(m[g & 3], m[(g - 1) & 3], 4);
+            m[(g + 1) & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(m[(g + 1) & 3], t), m[g & 3]);
+        }
+        msg = _mm_shuffle_epi32(msg, 0x0E);
+        st0 = _mm_sha256rnds2_epu32(st0, st1, msg);
+        if (g >= 1 && g <= 12) m[(g - 1) & 3] = _mm_sha256msg1_epu32(m[(g - 1) & 3], m[g & 3]);
+    }
+
+    st0 = _mm_add_epi32(st0, abef);
+    st1 = _mm_add_epi32(st1, cdgh);
+    tmp = _mm_shuffle_epi32(st0, 0x1B);                  // FEBA
+    st1 = _mm_shuffle_epi32(st1, 0xB1);                  // DCHG
+    st0 = _mm_blend_epi16(tmp, st1, 0xF0);               // DCBA
+    st1 = _mm_alignr_epi8(st1, tmp, 8);                  // HGFE
+    _mm_storeu_si128((__m128i*)&state[0], st0);
+    _mm_storeu_si128((__m128i*)&state[4], st1);
+}
+
+__attribute__((target("sha,sse4.1")))
+static ScanResult sha256d_scan_shani(const JobPrecompute* job, const ShareTarget* target,
+                                     uint32_t nonce_begin, uint32_t count, Candidate* out, size_t max_out) {
+    uint32_t block1[16] = {
+        job->tail[0], job->tail[1], job->tail[2], 0, H1_PAD,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, H1_LEN
+    };
+    uint32_t block2[16] = {
+        0, 0, 0, 0, 0, 0, 0, 0, H2_PAD, 0, 0, 0, 0, 0, 0, H2_LEN
+    };
+
+    ScanResult res = {count, 0, 0};
+    const uint32_t mask = target->h7_mask;
+    uint32_t nonce = nonce_begin;
+    const uint32_t end = nonce_begin + count;
+
+    while (nonce != end) {
+        block1[3] = __builtin_bswap32(nonce);
+        memcpy(block2, job->midstate, 32);
+        shani_transform(block2, block1);
+
+        uint32_t state[8];
+        sha256_init_state(state);
+        shani_transform(state, block2);
+
+        if (__builtin_expect((state[7] & mask) == 0, 0)) {
+            if (scan_hit(job, target, nonce, state[7], &out[res.found], res) && ++res.found == max_out) {
+                res.scanned = nonce - nonce_begin + 1;
+                break;
+            }
+        }
+        nonce++;
+    }
+    return res;
+}
+
+// ----------------------------------------------------------------------------
+// RUNTIME DISPATCH
+// ----------------------------------------------------------------------------
+static bool cpu_has(Sha256Backend backend) {
+    switch (backend) {
+        case SHA256_BACKEND_SCALAR: return true;
+        case SHA256_BACKEND_SSE2:   return __builtin_cpu_supports("sse2");
+        case SHA256_BACKEND_AVX2:   return __builtin_cpu_supports("avx2");
+        case SHA256_BACKEND_SHANI: {
+            unsigned int eax, ebx, ecx, edx;
+            if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+            return (ebx & bit_SHA) && __builtin_cpu_supports("sse4.1");
+        }
+    }
+    return false;
+}
+
+// AVX2 first: 8 lanes sharing the per-job precompute and the early exit
+// outrun two full SHA-NI compressions per nonce on the cores measured.
+static Sha256Backend detect_backend() {
+    __builtin_cpu_init();
+    if (cpu_has(SHA256_BACKEND_AVX2))  return SHA256_BACKEND_AVX2;
+    if (cpu_has(SHA256_BACKEND_SHANI)) return SHA256_BACKEND_SHANI;
+    if (cpu_has(SHA256_BACKEND_SSE2))  return SHA256_BACKEND_SSE2;
+    return SHA256_BACKEND_SCALAR;
+}
+
+static Sha256Backend& active_backend() {
+    static Sha256Backend backend = detect_backend();
+    return backend;
+}
+
+Sha256Backend sha256_backend() {
+    return active_backend();
+}
+
+bool sha256_set_backend(Sha256Backend backend) {
+    if (!cpu_has(backend)) return false;
+    active_backend() = backend;
+    return true;
+}
+
+ScanResult sha256d_scan(const JobPrecompute* job, const ShareTarget* target,
+                        uint32_t nonce_begin, uint32_t count, Candidate* out, size_t max_out) {
+    switch (active_backend()) {
+        case SHA256_BACKEND_SHANI: return sha256d_scan_shani(job, target, nonce_begin, count, out, max_out);
+        case SHA256_BACKEND_AVX2:  return sha256d_scan_avx2(job, target, nonce_begin, count, out, max_out);
+        case SHA256_BACKEND_SSE2:  return sha256d_scan_sse2(job, target, nonce_begin, count, out, max_out);
+        default:                   return sha256d_scan_scalar(job, target, nonce_begin, count, out, max_out);
+    }
+}
+
+#endif // SHA256_HOST_SIMD
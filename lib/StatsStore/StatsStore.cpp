@@ -0,0 +1,127 @@
+// ============================================================================
+// StatsStore.cpp - lifetime statistics checkpointed to NVS
+// ============================================================================
+#include "StatsStore.h"
+
+void StatsStore::begin() {
+    mutex = xSemaphoreCreateMutex();
+    restore();
+    base.boots++;
+    totals = base;
+    saved = base;
+    memset(last_shares, 0, sizeof(last_shares));
+    memset(last_valids, 0, sizeof(last_valids));
+    memset(seen, 0, sizeof(seen));
+
+    // Checkpoint now: the boot counts even if the device never runs long
+    // enough for a timed write
+    flush();
+}
+
+// The blob if it matches this layout, else a fresh start
+void StatsStore::restore() {
+    memset(&base, 0, sizeof(base));
+    prefs.begin("stats", true);
+    if (prefs.getBytesLength("lifetime") == sizeof(LifetimeStats)) {
+        prefs.getBytes("lifetime", &base, sizeof(base));
+    }
+    prefs.end();
+    if (base.version != STATS_VERSION) {
+        memset(&base, 0, sizeof(base));
+        base.version = STATS_VERSION;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// MONITOR SIDE
+// ----------------------------------------------------------------------------
+void StatsStore::update(unsigned long now_ms, const WorkerCounters& counters,
+                        const MinerStats* miners, uint8_t self) {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+
+    // This device: earlier boots plus the counters, which start at zero
+    totals.uptime_s = base.uptime_s + now_ms / 1000;
+    totals.hashes = base.hashes + counters.hashes;
+    totals.halfshares = base.halfshares + counters.halfshares;
+    totals.shares = base.shares + counters.shares;
+    totals.valids = base.valids + counters.valids;
+    totals.templates = base.templates + templates.load(std::memory_order_relaxed);
+    totals.best_difficulty = (counters.best_difficulty > base.best_difficulty)
+                             ? counters.best_difficulty : base.best_difficulty;
+    totals.effective_hashes = base.effective_hashes + counters.share_difficulty * DIFF1_HASHES;
+    for (int i = 0; i < DIFF_BUCKETS; i++) {
+        totals.difficulty_histogram[i] = base.difficulty_histogram[i] + counters.difficulty_histogram[i];
+    }
+
+    // Cluster: only what a miner added since its last report. A count that
+    // went down means it restarted and counts from zero again. The first
+    // report after our own boot is only a baseline, it may already be saved.
+    for (size_t i = 0; i <= MAX_MINERS; i++) {
+        LifetimeMiner& total = totals.miners[i];
+        if (i == self) {
+            total.shares = base.miners[i].shares + counters.shares;
+            total.valids = base.miners[i].valids + counters.valids;
+            total.best_difficulty = totals.best_difficulty;
+            continue;
+        }
+
+        const MinerStats& m = miners[i];
+        if (!m.online) continue;
+        if (seen[i]) {
+            total.shares += (m.shares >= last_shares[i]) ? m.shares - last_shares[i] : m.shares;
+            total.valids += (m.valids >= last_valids[i]) ? m.valids - last_valids[i] : m.valids;
+        }
+        seen[i] = true;
+        last_shares[i] = m.shares;
+        last_valids[i] = m.valids;
+        if (m.bestDifficulty > total.best_difficulty) total.best_difficulty = m.bestDifficulty;
+    }
+
+    if (due(now_ms)) write(now_ms);
+    xSemaphoreGive(mutex);
+}
+
+// Blocks and new best shares are written within a minute; everything else
+// waits for the interval, and is skipped if it would barely change flash
+bool StatsStore::due(unsigned long now_ms) const {
+    unsigned long since = now_ms - last_write;
+
+    bool urgent = totals.valids != saved.valids || totals.best_difficulty > saved.best_difficulty;
+    bool changed = totals.shares != saved.shares ||
+                   totals.hashes - saved.hashes >= STATS_SAVE_MIN_HASHES;
+    for (size_t i = 0; i <= MAX_MINERS; i++) {
+        urgent |= totals.miners[i].valids != saved.miners[i].valids;
+        changed |= totals.miners[i].shares != saved.miners[i].shares ||
+                   totals.miners[i].best_difficulty != saved.miners[i].best_difficulty;
+    }
+
+    if (urgent && since >= STATS_URGENT_SAVE_MS) return true;
+    return changed && since >= STATS_SAVE_INTERVAL_MS;
+}
+
+// Caller holds the mutex
+void StatsStore::write(unsigned long now_ms) {
+    prefs.begin("stats", false);
+    prefs.putBytes("lifetime", &totals, sizeof(totals));
+    prefs.end();
+    saved = totals;
+    last_write = now_ms;
+}
+
+// ----------------------------------------------------------------------------
+// ANY TASK
+// ----------------------------------------------------------------------------
+void StatsStore::flush() {
+    if (!mutex) return;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    write(millis());
+    xSemaphoreGive(mutex);
+}
+
+LifetimeStats StatsStore::snapshot() {
+    if (!mutex) return LifetimeStats{};
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    LifetimeStats copy = totals;
+    xSemaphoreGive(mutex);
+    return copy;
+}
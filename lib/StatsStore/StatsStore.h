@@ -0,0 +1,71 @@
+// ============================================================================
+// StatsStore.h - lifetime statistics checkpointed to NVS
+// Lifetime hashes, shares, best difficulty, uptime and per-miner totals,
+// restored at boot and added to by every boot after it. Writes are batched:
+// a checkpoint only when something worth keeping changed, at most every
+// STATS_SAVE_INTERVAL_MS, sooner for a block or a new best share, and on
+// request before a restart. One ~500-byte blob per write keeps flash wear low.
+// ============================================================================
+#pragma once
+#include <Arduino.h>
+#include <Preferences.h>
+#include "MiningCore.h"
+
+static const uint32_t STATS_VERSION = 1;    // bump when LifetimeStats changes layout
+
+struct LifetimeMiner {
+    uint64_t shares;
+    uint64_t valids;
+    double best_difficulty;
+};
+
+struct LifetimeStats {
+    uint32_t version;
+    uint32_t boots;
+    uint64_t uptime_s;
+    uint64_t hashes;
+    uint64_t halfshares;
+    uint64_t shares;
+    uint64_t valids;
+    uint64_t templates;
+    double best_difficulty;
+    double effective_hashes;    // share difficulty x DIFF1_HASHES
+    uint32_t difficulty_histogram[DIFF_BUCKETS];
+    LifetimeMiner miners[MAX_MINERS + 1];  // indexed like miners[]
+};
+
+class StatsStore {
+public:
+    // Setup, before the monitor starts: restores the blob, counts a boot
+    // and saves it
+    void begin();
+
+    // Monitor task: folds this boot's counters and the cluster table into
+    // the totals and checkpoints when due. `self` is this device's slot in
+    // miners[]; the others report counts that restart with their firmware.
+    void update(unsigned long now_ms, const WorkerCounters& counters,
+                const MinerStats* miners, uint8_t self);
+
+    // Any task: write now, e.g. right before ESP.restart()
+    void flush();
+
+    // Any task: totals as of the last update()
+    LifetimeStats snapshot();
+
+private:
+    Preferences prefs;
+    SemaphoreHandle_t mutex = nullptr;
+    LifetimeStats base;         // earlier boots, fixed after begin()
+    LifetimeStats totals;       // base + this boot
+    LifetimeStats saved;        // what flash holds
+    unsigned long last_write = 0;
+
+    // Last count each remote miner reported, to add only the increase
+    int last_shares[MAX_MINERS + 1];
+    int last_valids[MAX_MINERS + 1];
+    bool seen[MAX_MINERS + 1];
+
+    void restore();
+    bool due(unsigned long now_ms) const;
+    void write(unsigned long now_ms);
+};
@@ -0,0 +1,662 @@
+// ============================================================================
+// Stratum.cpp - pool connection, job parsing and share submission
+// ============================================================================
+#include "Stratum.h"
+#include "configs.h"
+#include "Hex.h"
+#include <math.h>
+
+#ifdef M5CORE2
+#include <M5Core2.h>
+#endif
+
+// Share target = difficulty-1 target (0xFFFF * 2^208) / difficulty as 8
+// little-endian words, top word first. Double precision is plenty: only the
+// top bits matter to the pool and the rest is truncated, i.e. slightly harder.
+static void difficultyToTarget(double difficulty, uint8_t* target) {
+    double value = 65535.0 * ldexp(1.0, 208) / difficulty;
+    for (int w = 7; w >= 0; w--) {
+        double scale = ldexp(1.0, 32 * w);
+        double word = floor(value / scale);
+        uint32_t bits = (word >= 4294967295.0) ? 0xFFFFFFFF : (uint32_t)word;
+        value -= (double)bits * scale;
+        if (value < 0) value = 0;
+        memcpy(target + 4 * w, &bits, 4);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// SHARED HELPERS
+// ----------------------------------------------------------------------------
+// Network target = mantissa * 256^(exponent - 3), little-endian
+void nbitsToTarget(uint32_t nbits, uint8_t* target) {
+    memset(target, 0, 32);
+    int exponent = nbits >> 24;
+    for (int i = 0; i < 3; i++) {
+        int pos = exponent - 3 + i;
+        if (pos >= 0 && pos < 32) target[pos] = (nbits >> (8 * i)) & 0xFF;
+    }
+}
+
+bool targetBelow(const uint8_t* a, const uint8_t* b) {
+    for (int i = 31; i >= 0; i--) {
+        if (a[i] != b[i]) return a[i] < b[i];
+    }
+    return false;
+}
+
+void recordSubmitResult(uint32_t rtt_ms, bool accepted, int error, bool flushed) {
+    int bucket = (rtt_ms < 32) ? 0 : (31 - __builtin_clz(rtt_ms)) - 4;
+    if (bucket >= SUBMIT_RTT_BUCKETS) bucket = SUBMIT_RTT_BUCKETS - 1;
+
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    submitStats.last_rtt_ms = rtt_ms;
+    submitStats.rtt_histogram[bucket]++;
+    if (accepted) {
+        submitStats.accepted++;
+    } else {
+        submitStats.rejected++;
+        // Pools without error codes still reject shares for flushed jobs
+        if (error == 21 || (!error && flushed)) submitStats.stale++;
+        else if (error == 22) submitStats.duplicate++;
+        else if (error == 23) submitStats.low_difficulty++;
+    }
+    xSemaphoreGive(statsMutex);
+}
+
+void announceBlock() {
+#ifdef M5CORE2
+    // Block found celebration - only on M5Core2
+    for (int f = 0; f < 15; f++) {
+        M5.Lcd.fillScreen(GREEN);
+        vTaskDelay(80 / portTICK_PERIOD_MS);
+        M5.Lcd.fillScreen(BLACK);
+        vTaskDelay(80 / portTICK_PERIOD_MS);
+    }
+#else
+    Serial.println("\n*** BLOCK FOUND! ***\n");
+#endif
+}
+
+// Mark every job issued so far as stale. Called with the job lock held.
+// A pool flush also starts the stale interval; a lost connection does not,
+// its outage is not time spent on stale work.
+void JobSource::invalidateJobs(bool pool_flush) {
+    if (pool_flush) {
+        stale_since = millis();
+        stale_open.store(true, std::memory_order_release);
+    }
+    clean_generation.store(job_generation.load() + 1, std::memory_order_release);
+}
+
+// The producer has work for a live job again: the interval the last flush
+// started ends here, counted once however many threads were mining
+void JobSource::workResumed() {
+    if (stale_open.exchange(false, std::memory_order_acq_rel)) {
+        staleWorkMs.fetch_add(millis() - stale_since, std::memory_order_relaxed);
+    }
+}
+
+void* stratumAlloc(size_t& size) {
+    if (psramFound()) {
+        if (void* buf = ps_malloc(size)) return buf;
+    }
+    if (size > STRATUM_LINE_MAX_INTERNAL) size = STRATUM_LINE_MAX_INTERNAL;
+    bool logged = false;
+    while (true) {
+        if (void* buf = malloc(size)) return buf;
+        if (size > MIN_LINE_BUFFER) {
+            size /= 2;
+        } else {
+            // A heap this full has nothing else running either; wait for it
+            // rather than reboot into the same state
+            if (!logged) Serial.println("Stratum: no memory for the line buffers, waiting");
+            logged = true;
+            vTaskDelay(1000 / portTICK_PERIOD_MS);
+        }
+    }
+}
+
+StratumSession::StratumSession() : reader(nullptr, 0) {
+    size_t line_size = STRATUM_LINE_MAX;
+    char* line = (char*)stratumAlloc(line_size);
+    reader = StratumLineReader(line, line_size);
+    coinb2_cap = line_size < 2 * MAX_COINB2 ? line_size / 2 : MAX_COINB2;
+    coinb2 = (uint8_t*)stratumAlloc(coinb2_cap);
+    memset(pending, 0, sizeof(pending));
+    history.clear();
+    jobMutex = xSemaphoreCreateMutex();
+    shareQueue = xQueueCreate(10, sizeof(ShareSubmission));
+}
+
+bool StratumSession::addPool(const char* host, uint16_t port) {
+    if (!host || !*host || pool_count == MAX_POOLS) return false;
+    PoolEntry& pool = pools[pool_count++];
+    memset(&pool, 0, sizeof(pool));
+    strncpy(pool.host, host, sizeof(pool.host) - 1);
+    pool.port = port;
+    return true;
+}
+
+void StratumSession::begin() {
+    xTaskCreatePinnedToCore(
+        [](void* param) { ((StratumSession*)param)->run(); },
+        "Stratum", STRATUM_STACK_SIZE, this, STRATUM_PRIORITY, nullptr, 0);
+}
+
+// ----------------------------------------------------------------------------
+// SESSION TASK
+// Owns the socket: reads pool messages and writes the workers' shares.
+// ----------------------------------------------------------------------------
+void StratumSession::run() {
+    if (!pool_count) addPool(POOL_URL, POOL_PORT);
+    probePools();
+
+    while (true) {
+        int index = selectPool();
+        PoolEntry& pool = pools[index];
+
+        unsigned long t0 = millis();
+        if (!client.connect(pool.host, pool.port, POOL_CONNECT_TIMEOUT_MS)) {
+            poolFailed(pool);
+            continue;
+        }
+        uint32_t rtt = millis() - t0;
+        pool.rtt_ms = pool.rtt_ms ? (3 * pool.rtt_ms + rtt) / 4 : (rtt ? rtt : 1);
+        active_pool = index;
+
+        client.setTimeout(10000);
+        client.setNoDelay(true);
+        is_connected = true;
+        reader.reset();
+        handshake();
+        unsigned long connected_at = millis();
+
+        while (client.connected()) {
+            sendShares();
+            expireSubmits(false);
+            if (client.available()) {
+                readLines();
+            } else {
+                vTaskDelay(10 / portTICK_PERIOD_MS);
+            }
+        }
+
+        // Work from the old connection belongs to the old extranonce1, and
+        // its unanswered shares will never be answered
+        expireSubmits(true);
+        is_connected = false;
+        subscribed = false;
+        if (listener) listener->sessionLost();
+        xSemaphoreTake(jobMutex, portMAX_DELAY);
+        job_ready = false;
+        invalidateJobs(false);
+        history.clear();
+        xSemaphoreGive(jobMutex);
+        client.stop();
+
+        // A pool that keeps dropping us backs off like one that refuses us
+        if (millis() - connected_at < POOL_STABLE_MS) {
+            poolFailed(pool);
+        } else {
+            pool.failures = 0;
+            pool.retry_at = millis();
+        }
+    }
+}
+
+// ----------------------------------------------------------------------------
+// POOL SELECTION
+// Every pool is connected to once at start to measure its connect time,
+// then the fastest pool that is not backing off is used. A failure doubles
+// that pool's backoff (with jitter), so the others take over meanwhile.
+// ----------------------------------------------------------------------------
+void StratumSession::probePools() {
+    for (size_t i = 0; i < pool_count; i++) {
+        unsigned long t0 = millis();
+        if (client.connect(pools[i].host, pools[i].port, POOL_CONNECT_TIMEOUT_MS)) {
+            uint32_t rtt = millis() - t0;
+            pools[i].rtt_ms = rtt ? rtt : 1;
+        } else {
+            poolFailed(pools[i]);
+        }
+        client.stop();
+    }
+}
+
+int StratumSession::selectPool() {
+    while (true) {
+        unsigned long now = millis();
+        int best = -1;
+        long wait = (long)POOL_BACKOFF_MAX_MS;
+        for (size_t i = 0; i < pool_count; i++) {
+            long until = (long)(pools[i].retry_at - now);
+            if (until > 0) {
+                if (until < wait) wait = until;
+                continue;
+            }
+            // Unmeasured pools (rtt 0) go after every measured one, in list order
+            uint32_t rtt = pools[i].rtt_ms ? pools[i].rtt_ms : UINT32_MAX;
+            if (best < 0 || rtt < (pools[best].rtt_ms ? pools[best].rtt_ms : UINT32_MAX)) best = i;
+        }
+        if (best >= 0) return best;
+        vTaskDelay(wait / portTICK_PERIOD_MS + 1);
+    }
+}
+
+void StratumSession::poolFailed(PoolEntry& pool) {
+    if (pool.failures < 16) pool.failures++;
+    unsigned long backoff = POOL_BACKOFF_BASE_MS << (pool.failures - 1);
+    if (backoff > POOL_BACKOFF_MAX_MS || pool.failures > 16) backoff = POOL_BACKOFF_MAX_MS;
+    // +-50% jitter so a swarm that lost the same pool does not return in step
+    backoff = backoff / 2 + esp_random() % (backoff + 1);
+    pool.retry_at = millis() + backoff;
+}
+
+void StratumSession::handshake() {
+    char request[192];
+
+    // BIP 310 version rolling over the BIP 320 general purpose bits. Pools
+    // without mining.configure answer with an error and we mine without it.
+    version_mask = 0;
+    pending_difficulty = 1.0;
+    snprintf(request, sizeof(request),
+        "{\"id\":3,\"method\":\"mining.configure\",\"params\":[[\"version-rolling\"],"
+        "{\"version-rolling.mask\":\"%08lx\",\"version-rolling.min-bit-count\":2}]}\n",
+        (unsigned long)VERSION_ROLLING_MASK);
+    client.print(request);
+
+    // Offering the pool's last session id lets it resume our extranonce1
+    const char* session_id = pools[active_pool].session_id;
+    if (*session_id) {
+        snprintf(request, sizeof(request),
+            "{\"id\":1,\"method\":\"mining.subscribe\",\"params\":[\"%s\",\"%s\"]}\n",
+            STRATUM_USER_AGENT, session_id);
+    } else {
+        snprintf(request, sizeof(request),
+            "{\"id\":1,\"method\":\"mining.subscribe\",\"params\":[\"%s\"]}\n", STRATUM_USER_AGENT);
+    }
+    client.print(request);
+
+    snprintf(request, sizeof(request),
+        "{\"id\":2,\"method\":\"mining.authorize\",\"params\":[\"%s\",\"x\"]}\n", ADDRESS);
+    client.print(request);
+}
+
+// Pull whatever the socket has into the line buffer and handle every
+// complete line; no String, no JSON document, nothing on the heap
+void StratumSession::readLines() {
+    int n = client.read((uint8_t*)reader.writePtr(), reader.space());
+    if (n <= 0) return;
+    reader.commit(n);
+
+    char* line;
+    size_t len;
+    while ((line = reader.next(&len)) != nullptr) {
+        // Proxy mode relays jobs verbatim; parsing below rewrites the line
+        if (listener && (strstr(line, "\"mining.notify\"") || strstr(line, "\"mining.set_difficulty\""))) {
+            listener->poolLine(line, len);
+        }
+        handleLine(line, len);
+    }
+    while (dropped_logged != reader.dropped()) {
+        dropped_logged++;
+        Serial.println("Stratum: dropped a line longer than the line buffer");
+    }
+}
+
+void StratumSession::handleLine(char* line, size_t len) {
+    if (!msg.parse(line, len)) {
+        Serial.println("Stratum: dropped a line that is not valid JSON");
+        return;
+    }
+    int root = msg.root();
+
+    const char* method = msg.str(msg.find(root, "method"));
+    int params = msg.find(root, "params");
+    if (!strcmp(method, "mining.notify")) {
+        handleNotify(params);
+        return;
+    }
+    if (!strcmp(method, "mining.set_difficulty")) {
+        double difficulty = msg.number(msg.at(params, 0));
+        if (difficulty > 0) pending_difficulty = difficulty;
+        return;
+    }
+    if (!strcmp(method, "mining.set_version_mask")) {
+        uint32_t mask;
+        if (hex_to_u32(msg.str(msg.at(params, 0)), &mask)) version_mask = mask & VERSION_ROLLING_MASK;
+        return;
+    }
+
+    int result = msg.find(root, "result");
+    long id = msg.integer(msg.find(root, "id"));
+    if (id >= (long)FIRST_SUBMIT_ID) {
+        // mining.submit answer: true, or false/null plus [code, message, ...]
+        int error = msg.find(root, "error");
+        int code = msg.isArray(error) ? msg.integer(msg.at(error, 0), -1)
+                                      : msg.integer(msg.find(error, "code"), -1);
+        handleSubmitResult(id, msg.boolean(result) ? 1 : 0, msg.isNull(error) ? 0 : code);
+        return;
+    }
+    switch (id) {
+        case 3:  // mining.configure
+            uint32_t mask;
+            if (msg.boolean(msg.find(result, "version-rolling")) &&
+                hex_to_u32(msg.str(msg.find(result, "version-rolling.mask")), &mask)) {
+                version_mask = mask & VERSION_ROLLING_MASK;
+            }
+            break;
+        case 1: {  // mining.subscribe
+            int en1 = msg.at(result, 1);
+            size_t en1_len = msg.strLength(en1);
+            if (en1_len > 2 * MAX_EXTRANONCE1 || !hex_decode(msg.str(en1), en1_len, extranonce1)) break;
+            extranonce1_size = en1_len / 2;
+            rememberSession(msg.at(result, 0));
+            int size = msg.integer(msg.at(result, 2), 8);
+            extranonce2_size = constrain(size, 1, (int)MAX_EXTRANONCE2);
+            subscribed = true;
+            break;
+        }
+        default:   // authorize
+            break;
+    }
+}
+
+// The subscription id for mining.notify is the session id pools accept
+// back on reconnect. result[0] is either [[method, id], ...] or one pair.
+void StratumSession::rememberSession(int subscriptions) {
+    int pair = msg.at(subscriptions, 0);
+    if (!msg.isArray(pair)) pair = subscriptions;
+    for (size_t i = 0; msg.isArray(pair); pair = msg.at(subscriptions, ++i)) {
+        if (!strcmp(msg.str(msg.at(pair, 0)), "mining.notify")) break;
+    }
+    const char* id = msg.str(msg.at(pair, 1));
+    char* session_id = pools[active_pool].session_id;
+    if (strlen(id) >= sizeof(pools[0].session_id)) id = "";
+    if (*session_id && !strcmp(session_id, id)) {
+        Serial.println("Stratum session resumed");
+    }
+    strcpy(session_id, id);
+}
+
+// ----------------------------------------------------------------------------
+// JOB PARSING
+// Decoded once per notify for all workers. The coinbase prefix hash is
+// computed here too, so a worker only hashes extranonce2 + coinb2.
+// ----------------------------------------------------------------------------
+void StratumSession::handleNotify(int params) {
+    if (!subscribed) return;
+
+    const char* job_id   = msg.str(msg.at(params, 0));
+    const char* prevhash = msg.str(msg.at(params, 1));
+    int coinb1           = msg.at(params, 2);
+    int coinb2_h         = msg.at(params, 3);
+    int branch           = msg.at(params, 4);
+
+    size_t branch_count = msg.size(branch);
+    size_t coinb1_len = msg.strLength(coinb1);
+    size_t coinb2_hex_len = msg.strLength(coinb2_h);
+    if (!msg.isArray(branch) || branch_count > MAX_MERKLE_BRANCH || coinb2_hex_len > 2 * coinb2_cap) {
+        Serial.println("Stratum: dropped a notify with an oversized merkle branch or coinbase");
+        return;
+    }
+
+    uint32_t version, nbits, ntime;
+    if (!hex_to_u32(msg.str(msg.at(params, 5)), &version) ||
+        !hex_to_u32(msg.str(msg.at(params, 6)), &nbits) ||
+        !hex_to_u32(msg.str(msg.at(params, 7)), &ntime)) {
+        Serial.println("Stratum: dropped a notify with a bad version, nbits or ntime");
+        return;
+    }
+
+    // coinb1 is only ever hashed, so it is decoded inside the line buffer
+    uint8_t* coinb1_bin = (uint8_t*)msg.str(coinb1);
+    if (!hex_decode(msg.str(coinb1), coinb1_len, coinb1_bin)) {
+        Serial.println("Stratum: dropped a notify with a bad coinb1");
+        return;
+    }
+
+    // Hex goes straight from the line buffer into the job's binary fields
+    xSemaphoreTake(jobMutex, portMAX_DELAY);
+
+    bool ok = hex_decode_exact(prevhash, job.prevhash, 32);
+    for (size_t i = 0; ok && i < branch_count; i++) {
+        ok = hex_decode_exact(msg.str(msg.at(branch, i)), job.merkle_branch[i], 32);
+    }
+    coinb2_len = coinb2_hex_len / 2;
+    ok = ok && hex_decode(msg.str(coinb2_h), coinb2_hex_len, coinb2);
+
+    if (!ok) {
+        // The old job's buffers are half overwritten: stop handing it out
+        job_ready = false;
+        xSemaphoreGive(jobMutex);
+        Serial.println("Stratum: dropped a notify with bad prevhash, branch or coinb2 hex");
+        return;
+    }
+
+    strncpy(job.job_id, job_id, sizeof(job.job_id) - 1);
+    job.job_id[sizeof(job.job_id) - 1] = '\0';
+    job.merkle_count = branch_count;
+    job.version = version;
+    job.nbits = nbits;
+    job.ntime = ntime;
+    job.clean_jobs = msg.boolean(msg.at(params, 8));
+    job.extranonce2_size = extranonce2_size;
+    job.version_mask = version_mask;
+    job.header_only = false;
+
+    // Stratum sends prevhash as 8 byte-swapped words
+    for (int w = 0; w < 32; w += 4) {
+        std::swap(job.prevhash[w], job.prevhash[w + 3]);
+        std::swap(job.prevhash[w + 1], job.prevhash[w + 2]);
+    }
+
+    nbitsToTarget(job.nbits, job.target);
+
+    // mining.set_difficulty applies from the next notify on. A share target
+    // harder than the block target would hide blocks, so cap it there.
+    job.difficulty = pending_difficulty;
+    difficultyToTarget(job.difficulty, job.share_target);
+    if (targetBelow(job.share_target, job.target)) memcpy(job.share_target, job.target, 32);
+
+    sha256_init(&job.coinbase_prefix);
+    sha256_update(&job.coinbase_prefix, coinb1_bin, coinb1_len / 2);
+    sha256_update(&job.coinbase_prefix, extranonce1, extranonce1_size);
+
+    // A clean job makes everything before it worthless: workers poll
+    // isStale() between batches and drop the old job right away
+    if (job.clean_jobs) invalidateJobs(true);
+    job.generation = job_generation.load() + 1;
+    JobRecord& record = history.add(job.generation, *this);
+    memcpy(record.job_id, job.job_id, sizeof(record.job_id));
+    record.ntime = job.ntime;
+    record.version_mask = job.version_mask;
+    record.extranonce2_size = job.extranonce2_size;
+    job_generation.store(job.generation, std::memory_order_release);
+    job_ready = true;
+    xSemaphoreGive(jobMutex);
+
+    templates.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool StratumSession::subscription(char* extranonce1_hex, size_t cap, uint8_t* en2_size) {
+    xSemaphoreTake(jobMutex, portMAX_DELAY);
+    bool ok = subscribed && cap > 2u * extranonce1_size;
+    if (ok) {
+        hex_encode(extranonce1, extranonce1_size, extranonce1_hex);
+        *en2_size = extranonce2_size;
+    }
+    xSemaphoreGive(jobMutex);
+    return ok;
+}
+
+uint32_t StratumSession::findJob(const char* job_id) {
+    uint32_t generation = 0;
+    xSemaphoreTake(jobMutex, portMAX_DELAY);
+    for (const JobRecord& record : history.records) {
+        if (record.generation && !isStale(record.generation) && !strcmp(record.job_id, job_id)) {
+            // Pools may reuse ids; the newest job with it wins
+            if (!generation || (int32_t)(record.generation - generation) > 0) generation = record.generation;
+        }
+    }
+    xSemaphoreGive(jobMutex);
+    return generation;
+}
+
+// Workers are kept apart by their extranonce2, so all get the same job
+bool StratumSession::copyJob(StratumJob* out, uint8_t /*worker*/) {
+    if (!job_ready) return false;
+    xSemaphoreTake(jobMutex, portMAX_DELAY);
+    bool ok = job_ready;
+    if (ok) *out = job;
+    xSemaphoreGive(jobMutex);
+    return ok;
+}
+
+bool StratumSession::merkleRoot(uint32_t generation, const uint8_t* extranonce2, uint8_t* root) {
+    xSemaphoreTake(jobMutex, portMAX_DELAY);
+    if (!job_ready || job.generation != generation) {
+        xSemaphoreGive(jobMutex);
+        return false;
+    }
+
+    SHA256_CTX ctx = job.coinbase_prefix;
+    sha256_update(&ctx, extranonce2, job.extranonce2_size);
+    sha256_update(&ctx, coinb2, coinb2_len);
+    sha256d_final(&ctx, root);
+
+    uint8_t pair[64];
+    for (uint8_t i = 0; i < job.merkle_count; i++) {
+        memcpy(pair, root, 32);
+        memcpy(pair + 32, job.merkle_branch[i], 32);
+        sha256_bitcoin_double(pair, 64, root);
+    }
+    xSemaphoreGive(jobMutex);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// SHARE SUBMISSION
+// Every share goes out on the session socket it was mined for.
+// ----------------------------------------------------------------------------
+bool StratumSession::submit(const ShareSubmission& share) {
+    return xQueueSend(shareQueue, &share, 0) == pdTRUE;  // Non-blocking
+}
+
+// ✅ OPTIMIZED: Reduced String operations
+void StratumSession::sendShares() {
+    ShareSubmission sub;
+    char payload[256];  // Pre-allocated buffer
+    char job_id[64];
+    uint8_t en2_bytes[MAX_EXTRANONCE2];
+    char extranonce2[2 * MAX_EXTRANONCE2 + 1];
+    uint32_t ntime = 0;
+    uint32_t mask = 0;
+    size_t en2_size = 0;
+
+    while (xQueueReceive(shareQueue, &sub, 0)) {
+        // Shares for a flushed job would only be rejected, but a block
+        // candidate goes out as long as its job is known: the pool decides
+        xSemaphoreTake(jobMutex, portMAX_DELAY);
+        const JobRecord* record = history.find(sub.generation);
+        bool known = record && (sub.valid || !isStale(sub.generation));
+        if (known) {
+            memcpy(job_id, record->job_id, sizeof(job_id));
+            ntime = sub.ntime ? sub.ntime : record->ntime;
+            en2_size = record->extranonce2_size;
+            mask = record->version_mask;  // a reconnect may have renegotiated it since
+        }
+        xSemaphoreGive(jobMutex);
+        if (!known) {
+            if (sub.valid) Serial.println("Stratum: block candidate for a forgotten job dropped");
+            if (sub.origin && listener) listener->shareResult(sub.origin, false);
+            continue;
+        }
+
+        // Shares are rare: extranonce2 only becomes text here
+        for (size_t i = 0; i < en2_size; i++) {
+            size_t shift = en2_size - 1 - i;
+            en2_bytes[i] = (shift < 8) ? (uint8_t)(sub.extranonce2 >> (8 * shift)) : 0;
+        }
+        hex_encode(en2_bytes, en2_size, extranonce2);
+
+        // ✅ Single snprintf instead of String concatenation
+        uint32_t id = trackSubmit(sub.generation, sub.origin);
+        if (mask) {
+            // BIP 310: the rolled version bits go in a sixth parameter
+            snprintf(payload, sizeof(payload),
+                "{\"id\":%lu,\"method\":\"mining.submit\",\"params\":[\"%s\",\"%s\",\"%s\",\"%08lx\",\"%08lx\",\"%08lx\"]}\n",
+                (unsigned long)id, ADDRESS, job_id, extranonce2, (unsigned long)ntime,
+                (unsigned long)sub.nonce, (unsigned long)(sub.version_bits & mask));
+        } else {
+            snprintf(payload, sizeof(payload),
+                "{\"id\":%lu,\"method\":\"mining.submit\",\"params\":[\"%s\",\"%s\",\"%s\",\"%08lx\",\"%08lx\"]}\n",
+                (unsigned long)id, ADDRESS, job_id, extranonce2, (unsigned long)ntime, (unsigned long)sub.nonce);
+        }
+
+        client.print(payload);
+
+        if (sub.valid) announceBlock();
+    }
+}
+
+// ----------------------------------------------------------------------------
+// SUBMIT TRACKING
+// Each mining.submit gets its own request id; the answer is matched back
+// here for accept/reject counters and the round-trip histogram.
+// ----------------------------------------------------------------------------
+uint32_t StratumSession::trackSubmit(uint32_t generation, uint8_t origin) {
+    uint32_t id = next_submit_id++;
+    if (next_submit_id == 0) next_submit_id = FIRST_SUBMIT_ID;
+
+    // Free slot, or else the oldest one: that share has waited longest
+    PendingSubmit* slot = &pending[0];
+    for (size_t i = 0; i < MAX_PENDING_SUBMITS; i++) {
+        if (pending[i].id == 0) { slot = &pending[i]; break; }
+        if ((long)(pending[i].sent_ms - slot->sent_ms) < 0) slot = &pending[i];
+    }
+
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    if (slot->id) submitStats.timed_out++;
+    submitStats.sent++;
+    xSemaphoreGive(statsMutex);
+    if (slot->id && slot->origin && listener) listener->shareResult(slot->origin, false);
+
+    slot->id = id;
+    slot->generation = generation;
+    slot->sent_ms = millis();
+    slot->origin = origin;
+    return id;
+}
+
+// result: 1 accepted, 0 rejected; error: stratum error code, 0 if none
+void StratumSession::handleSubmitResult(uint32_t id, int result, int error) {
+    PendingSubmit* slot = nullptr;
+    for (size_t i = 0; i < MAX_PENDING_SUBMITS; i++) {
+        if (pending[i].id == id) { slot = &pending[i]; break; }
+    }
+    if (!slot) return;  // already timed out
+
+    uint8_t origin = slot->origin;
+    slot->id = 0;
+    recordSubmitResult(millis() - slot->sent_ms, result && !error, error, isStale(slot->generation));
+
+    if (origin && listener) listener->shareResult(origin, result && !error);
+}
+
+void StratumSession::expireSubmits(bool all) {
+    unsigned long now = millis();
+    uint32_t expired = 0;
+    for (size_t i = 0; i < MAX_PENDING_SUBMITS; i++) {
+        if (pending[i].id && (all || now - pending[i].sent_ms > SUBMIT_TIMEOUT_MS)) {
+            pending[i].id = 0;
+            expired++;
+            if (pending[i].origin && listener) listener->shareResult(pending[i].origin, false);
+        }
+    }
+    if (!expired) return;
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    submitStats.timed_out += expired;
+    xSemaphoreGive(statsMutex);
+}
@@ -0,0 +1,265 @@
+// ============================================================================
+// Stratum.h - one pool session shared by every local miner thread
+// ============================================================================
+#pragma once
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <atomic>
+#include "sha256.h"
+#include "MiningCore.h"
+#include "StratumParser.h"
+
+static const size_t MAX_MERKLE_BRANCH = 16;  // 2^16 transactions per block
+static const size_t MAX_COINB2 = STRATUM_LINE_MAX / 2;  // coinbase tail, bytes: all a notify can carry
+static const size_t MIN_LINE_BUFFER = 1024;  // below this even a subscribe reply does not fit
+static const size_t MAX_EXTRANONCE1 = 16;
+static const size_t MAX_EXTRANONCE2 = 16;
+static const size_t JOB_HISTORY = 32;        // jobs a late share can still be sent for
+static const size_t MAX_PENDING_SUBMITS = 16;
+static const uint32_t FIRST_SUBMIT_ID = 16;  // request ids below are the handshake's
+static const size_t MAX_POOLS = 4;
+
+// Line and coinbase buffers, allocated once and never freed. PSRAM takes the
+// size asked for; internal RAM gets at most STRATUM_LINE_MAX_INTERNAL, halved
+// while even that fails. size is updated to what was obtained, and lines or
+// coinbases that do not fit are dropped with an error.
+void* stratumAlloc(size_t& size);
+
+// Parsed mining.notify, everything already decoded to header byte order.
+// Workers copy it; only the coinbase tail stays with the session.
+struct StratumJob {
+    uint32_t generation;        // bumps on every notify
+    char job_id[64];
+    uint32_t version;
+    uint32_t ntime;
+    uint32_t nbits;
+    uint8_t prevhash[32] __attribute__((aligned(4)));
+    uint8_t target[32] __attribute__((aligned(4)));  // network target from nbits
+    bool clean_jobs;
+
+    // Pool difficulty in force for this job and its share target (little-
+    // endian, never harder than the network target)
+    double difficulty;
+    uint8_t share_target[32] __attribute__((aligned(4)));
+
+    // Session parameters the job was issued under
+    uint8_t extranonce2_size;
+    uint32_t version_mask;      // BIP 310 mask granted by the pool, 0 = off
+
+    SHA256_CTX coinbase_prefix; // after coinb1 + extranonce1
+    uint8_t merkle_branch[MAX_MERKLE_BRANCH][32];
+    uint8_t merkle_count;
+
+    // Stratum V2 standard job: the pool's merkle root goes straight into the
+    // header and there is no coinbase to roll (extranonce2_size = 0)
+    bool header_only;
+    uint8_t merkle_root[32];
+};
+
+// ✅ OPTIMIZATION: Smaller, more efficient share submission structure.
+// Job id, ntime and extranonce2 size are looked up from the job generation
+// when the share is sent.
+struct ShareSubmission {
+    uint32_t generation;
+    uint32_t nonce;
+    uint32_t version_bits;      // rolled bits, sent when version rolling is on
+    uint32_t ntime;             // 0 = the job's own ntime
+    uint64_t extranonce2;       // big-endian value, low bytes of extranonce2;
+                                // for header-only jobs the worker index
+    uint8_t origin;             // 0 = local thread, else proxy miner slot + 1
+    bool valid;
+};
+
+// Hooks for a component relaying the session to other miners (proxy mode).
+// Called on the session task.
+class StratumListener {
+public:
+    // Raw mining.notify / mining.set_difficulty line, before it is parsed
+    virtual void poolLine(const char* line, size_t len) = 0;
+    // Pool verdict on a share from `origin`; rejected includes shares that
+    // were dropped or never answered
+    virtual void shareResult(uint8_t origin, bool accepted) = 0;
+    // Connection lost: extranonce1 and every job are gone
+    virtual void sessionLost() = 0;
+};
+
+// What a mining thread needs from a pool connection, whatever the protocol.
+// The generation counters live here so the checks the scan loop makes
+// between batches stay inline.
+class JobSource {
+public:
+    bool connected() const { return is_connected; }
+    uint32_t generation() const { return job_generation.load(std::memory_order_acquire); }
+
+    // True once job `generation` is dead: the pool sent clean_jobs after it
+    // or the connection dropped. Cheap enough to poll between scan batches.
+    bool isStale(uint32_t generation) const {
+        return (int32_t)(clean_generation.load(std::memory_order_acquire) - generation) > 0;
+    }
+    // Producer: work for a live job is ready, ends the stale interval
+    void workResumed();
+
+    // Copy of the current job for local worker `worker`; false until the
+    // first job of this connection
+    virtual bool copyJob(StratumJob* out, uint8_t worker) = 0;
+    // Coinbase hash for extranonce2 (job.extranonce2_size bytes) walked up to
+    // the merkle root; false if job `generation` has been replaced meanwhile
+    virtual bool merkleRoot(uint32_t generation, const uint8_t* extranonce2, uint8_t* root) = 0;
+    // Queue a share for the session socket (non-blocking); false if full
+    virtual bool submit(const ShareSubmission& share) = 0;
+
+protected:
+    volatile bool is_connected = false;
+    std::atomic<uint32_t> job_generation{0};     // bumps on every new job
+    std::atomic<uint32_t> clean_generation{0};   // first generation after the last flush
+    volatile unsigned long stale_since = 0;    // millis() of the last pool flush
+    std::atomic<bool> stale_open{false};      // flushed, no fresh work handed out yet
+
+    void invalidateJobs(bool pool_flush);
+};
+
+// ----------------------------------------------------------------------------
+// JOB HISTORY
+// What the share encoder needs from jobs that shares may still arrive for.
+// A record stays until its job is flushed and the slot is wanted, or until
+// the connection drops: a live job only gives way once all JOB_HISTORY
+// slots hold live jobs. Record needs a `generation` field, 0 = free slot.
+// Guarded by the session's jobMutex.
+// ----------------------------------------------------------------------------
+template <typename Record>
+struct JobHistory {
+    Record records[JOB_HISTORY];
+
+    void clear() { memset(records, 0, sizeof(records)); }
+
+    Record* find(uint32_t generation) {
+        if (!generation) return nullptr;
+        for (Record& record : records) {
+            if (record.generation == generation) return &record;
+        }
+        return nullptr;
+    }
+
+    // Zeroed record for a new job: a free slot, else the oldest flushed
+    // job's, else the oldest job's
+    Record& add(uint32_t generation, const JobSource& source) {
+        Record* slot = &records[0];
+        for (Record& record : records) {
+            if (!record.generation) { slot = &record; break; }
+            bool stale = source.isStale(record.generation);
+            bool slot_stale = source.isStale(slot->generation);
+            bool older = (int32_t)(record.generation - slot->generation) < 0;
+            if ((stale && !slot_stale) || (stale == slot_stale && older)) slot = &record;
+        }
+        memset(slot, 0, sizeof(*slot));
+        slot->generation = generation;
+        return *slot;
+    }
+};
+
+// ----------------------------------------------------------------------------
+// Shared by both protocols (Stratum.cpp)
+// ----------------------------------------------------------------------------
+// Network target from compact nbits, little-endian
+void nbitsToTarget(uint32_t nbits, uint8_t* target);
+// 256-bit little-endian compare, a < b
+bool targetBelow(const uint8_t* a, const uint8_t* b);
+// A pool verdict into submitStats. error: V1 code (21 stale, 22 duplicate,
+// 23 low difficulty), 0 if none; flushed: the share's job went stale
+void recordSubmitResult(uint32_t rtt_ms, bool accepted, int error, bool flushed);
+// Block found: celebrate on the screen or the serial port
+void announceBlock();
+
+// Stratum V1: newline-delimited JSON over one connection, with failover
+class StratumSession : public JobSource {
+public:
+    StratumSession();
+    // Pools in order of preference; call before begin(). The host is copied.
+    bool addPool(const char* host, uint16_t port);
+    void begin();               // starts the session task
+
+    bool copyJob(StratumJob* out, uint8_t worker) override;
+    bool merkleRoot(uint32_t generation, const uint8_t* extranonce2, uint8_t* root) override;
+    bool submit(const ShareSubmission& share) override;
+
+    // Proxy support
+    void setListener(StratumListener* l) { listener = l; }
+    // extranonce1 as hex and the extranonce2 size; false until subscribed
+    bool subscription(char* extranonce1_hex, size_t cap, uint8_t* extranonce2_size);
+    uint32_t versionMask() const { return version_mask; }
+    // Generation of a live job by pool job id, 0 if unknown or flushed
+    uint32_t findJob(const char* job_id);
+
+private:
+    WiFiClient client;
+
+    struct PoolEntry {
+        char host[64];
+        uint16_t port;
+        uint32_t rtt_ms;              // smoothed connect time, 0 = never reached
+        uint8_t failures;             // consecutive, drives the backoff
+        unsigned long retry_at;       // millis() before which the pool is skipped
+        char session_id[48];          // mining.subscribe id, offered back to resume
+    };
+    PoolEntry pools[MAX_POOLS];
+    StratumListener* listener = nullptr;
+    size_t pool_count = 0;
+    int active_pool = -1;
+
+    SemaphoreHandle_t jobMutex;
+    QueueHandle_t shareQueue;
+
+    volatile bool job_ready = false;
+
+    // Connection state, written by the session task only
+    uint8_t extranonce1[MAX_EXTRANONCE1];
+    uint8_t extranonce1_size = 0;
+    uint8_t extranonce2_size = 8;
+    volatile uint32_t version_mask = 0;
+    volatile bool subscribed = false;
+    double pending_difficulty = 1.0;  // from mining.set_difficulty, used by the next job
+
+    // What sendShares needs from recent jobs
+    struct JobRecord {
+        uint32_t generation;
+        char job_id[64];
+        uint32_t ntime;
+        uint32_t version_mask;        // as negotiated when the job came in
+        uint8_t extranonce2_size;
+    };
+    JobHistory<JobRecord> history;    // guarded by jobMutex
+
+    // mining.submit requests waiting for the pool's answer, by request id
+    struct PendingSubmit {
+        uint32_t id;                  // 0 = free slot
+        uint32_t generation;
+        unsigned long sent_ms;
+        uint8_t origin;
+    };
+    PendingSubmit pending[MAX_PENDING_SUBMITS];
+    uint32_t next_submit_id = FIRST_SUBMIT_ID;
+
+    // Parser state lives here, not on the task stack
+    StratumLineReader reader;
+    uint32_t dropped_logged = 0;
+    StratumMessage msg;
+
+    StratumJob job;                  // guarded by jobMutex
+    uint8_t* coinb2;                 // coinb2_cap bytes, guarded by jobMutex
+    size_t coinb2_cap;
+    size_t coinb2_len = 0;
+
+    void run();
+    void probePools();
+    int selectPool();
+    void poolFailed(PoolEntry& pool);
+    void handshake();
+    void readLines();
+    void handleLine(char* line, size_t len);
+    void handleNotify(int params);
+    void rememberSession(int subscriptions);
+    void sendShares();
+    uint32_t trackSubmit(uint32_t generation, uint8_t origin);
+    void handleSubmitResult(uint32_t id, int result, int error);
+    void expireSubmits(bool all);
+};
@@ -0,0 +1,201 @@
+// ============================================================================
+// StratumParser.cpp - fixed-buffer line reader and in-place JSON tokenizer
+// ============================================================================
+#include "StratumParser.h"
+#include <string.h>
+#include <stdlib.h>
+
+// ----------------------------------------------------------------------------
+// LINE READER
+// ----------------------------------------------------------------------------
+char* StratumLineReader::next(size_t* len) {
+    while (true) {
+        char* nl = (char*)memchr(buf + head, '\n', tail - head);
+        if (!nl) break;
+
+        char* line = buf + head;
+        size_t n = nl - line;
+        head += n + 1;
+        if (discarding) {
+            // Tail end of a line that did not fit: drop it and carry on
+            discarding = false;
+            continue;
+        }
+        if (n && line[n - 1] == '\r') n--;
+        line[n] = '\0';
+        if (len) *len = n;
+        return line;
+    }
+
+    // No complete line left: move the partial one to the front
+    if (head == tail) {
+        head = tail = 0;
+    } else if (head > 0) {
+        memmove(buf, buf + head, tail - head);
+        tail -= head;
+        head = 0;
+    }
+    if (space() == 0) {
+        // A full buffer without a newline can never become a line we keep
+        discarding = true;
+        dropped_lines++;
+        head = tail = 0;
+    }
+    return nullptr;
+}
+
+// ----------------------------------------------------------------------------
+// TOKENIZER
+// ----------------------------------------------------------------------------
+static inline bool isDelimiter(char c) {
+    return c == ',' || c == ']' || c == '}' || c == ':' ||
+           c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\0';
+}
+
+bool StratumMessage::parse(char* line, size_t len) {
+    text = line;
+    count = 0;
+    if (len >= 0xFFFF) return false;
+
+    uint16_t stack[STRATUM_MAX_DEPTH];
+    size_t depth = 0;
+
+    for (size_t i = 0; i < len; i++) {
+        char c = line[i];
+        switch (c) {
+            case ' ': case '\t': case '\r': case '\n': case ',': case ':':
+                break;
+
+            case '{': case '[': {
+                if (count == STRATUM_MAX_TOKENS || depth == STRATUM_MAX_DEPTH) return false;
+                if (depth) tokens[stack[depth - 1]].size++;
+                JsonToken& t = tokens[count];
+                t.type = (c == '{') ? JSON_OBJECT : JSON_ARRAY;
+                t.start = i;
+                t.size = 0;
+                stack[depth++] = count++;
+                break;
+            }
+
+            case '}': case ']': {
+                if (!depth) return false;
+                JsonToken& t = tokens[stack[--depth]];
+                if (t.type != ((c == '}') ? JSON_OBJECT : JSON_ARRAY)) return false;
+                t.end = i + 1;
+                t.next = count;
+                break;
+            }
+
+            case '"': {
+                size_t j = i + 1;
+                while (j < len && line[j] != '"') j += (line[j] == '\\') ? 2 : 1;
+                if (j >= len || count == STRATUM_MAX_TOKENS) return false;
+                if (depth) tokens[stack[depth - 1]].size++;
+                JsonToken& t = tokens[count];
+                t.type = JSON_STRING;
+                t.start = i + 1;
+                t.end = j;
+                t.size = 0;
+                t.next = ++count;
+                i = j;
+                break;
+            }
+
+            default: {
+                size_t j = i;
+                while (j < len && !isDelimiter(line[j])) j++;
+                if (count == STRATUM_MAX_TOKENS) return false;
+                if (depth) tokens[stack[depth - 1]].size++;
+                JsonToken& t = tokens[count];
+                t.type = JSON_PRIMITIVE;
+                t.start = i;
+                t.end = j;
+                t.size = 0;
+                t.next = ++count;
+                i = j - 1;
+                break;
+            }
+        }
+        if (!depth && count) {
+            // One top-level value per line; anything after it is ignored
+            if (tokens[0].type == JSON_OBJECT || tokens[0].type == JSON_ARRAY) {
+                if (c == '}' || c == ']') break;
+            } else {
+                break;
+            }
+        }
+    }
+    if (depth || !count) return false;
+
+    // Terminate scalars in place; safe now that the structure is known
+    for (uint16_t k = 0; k < count; k++) {
+        if (tokens[k].type == JSON_STRING || tokens[k].type == JSON_PRIMITIVE) {
+            line[tokens[k].end] = '\0';
+        }
+    }
+    return true;
+}
+
+int StratumMessage::find(int object, const char* key) const {
+    if (object < 0 || tokens[object].type != JSON_OBJECT) return -1;
+    int tok = object + 1;
+    while (tok < tokens[object].next) {
+        int value = tokens[tok].next;
+        if (value >= tokens[object].next) break;
+        if (tokens[tok].type == JSON_STRING && !strcmp(text + tokens[tok].start, key)) return value;
+        tok = tokens[value].next;
+    }
+    return -1;
+}
+
+int StratumMessage::at(int array, size_t index) const {
+    if (array < 0 || tokens[array].type != JSON_ARRAY || index >= tokens[array].size) return -1;
+    int tok = array + 1;
+    while (index--) tok = tokens[tok].next;
+    return tok;
+}
+
+size_t StratumMessage::size(int tok) const {
+    return (tok >= 0) ? tokens[tok].size : 0;
+}
+
+bool StratumMessage::isNull(int tok) const {
+    return tok < 0 || (tokens[tok].type == JSON_PRIMITIVE && text[tokens[tok].start] == 'n');
+}
+
+const char* StratumMessage::str(int tok, const char* fallback) const {
+    if (tok < 0 || tokens[tok].type != JSON_STRING) return fallback;
+    return text + tokens[tok].start;
+}
+
+const char* StratumMessage::raw(int tok, const char* fallback) const {
+    if (tok < 0 || tokens[tok].type == JSON_ARRAY || tokens[tok].type == JSON_OBJECT) return fallback;
+    return text + tokens[tok].start;
+}
+
+size_t StratumMessage::strLength(int tok) const {
+    if (tok < 0 || tokens[tok].type != JSON_STRING) return 0;
+    return tokens[tok].end - tokens[tok].start;
+}
+
+long StratumMessage::integer(int tok, long fallback) const {
+    if (tok < 0 || tokens[tok].type != JSON_PRIMITIVE || isNull(tok)) return fallback;
+    char c = text[tokens[tok].start];
+    if (c == 't' || c == 'f') return fallback;
+    return strtol(text + tokens[tok].start, nullptr, 10);
+}
+
+double StratumMessage::number(int tok, double fallback) const {
+    if (tok < 0 || tokens[tok].type != JSON_PRIMITIVE || isNull(tok)) return fallback;
+    char c = text[tokens[tok].start];
+    if (c == 't' || c == 'f') return fallback;
+    return strtod(text + tokens[tok].start, nullptr);
+}
+
+bool StratumMessage::boolean(int tok, bool fallback) const {
+    if (tok < 0 || tokens[tok].type != JSON_PRIMITIVE) return fallback;
+    char c = text[tokens[tok].start];
+    if (c == 't') return true;
+    if (c == 'f') return false;
+    return fallback;
+}
@@ -0,0 +1,106 @@
+// ============================================================================
+// StratumParser.h - fixed-buffer line reader and in-place JSON tokenizer
+// Nothing here allocates: lines live in the reader's buffer and tokens point
+// into them, so a notify costs the same every time. Host-compilable.
+// ============================================================================
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Pools with many payout outputs send notifies tens of KB long; the
+// tokenizer's 16-bit offsets are the real limit, so that is the line limit
+static const size_t STRATUM_LINE_MAX = 0xFFFF;  // longest line kept, longer ones are dropped
+static const size_t STRATUM_LINE_MAX_INTERNAL = 8192;  // limit without PSRAM
+static const size_t STRATUM_MAX_TOKENS = 96;    // notify with a full branch needs ~40
+static const size_t STRATUM_MAX_DEPTH = 8;
+
+// ----------------------------------------------------------------------------
+// LINE READER
+// The socket writes into writePtr()/space(), then next() hands out complete
+// lines, NUL-terminated in place. A line stays valid until the next call.
+// Storage comes from StratumLineBuffer<N>, sized per connection, or from
+// the owner (pool connections keep theirs off the internal RAM).
+// ----------------------------------------------------------------------------
+class StratumLineReader {
+public:
+    StratumLineReader(char* storage, size_t size) : buf(storage), capacity(size) {}
+
+    char* writePtr() { return buf + tail; }
+    size_t space() const { return capacity - 1 - tail; }
+    void commit(size_t n) { tail += n; }
+    char* next(size_t* len = nullptr);
+    void reset() { head = tail = 0; discarding = false; }
+    // Lines dropped for not fitting, ever; the owner logs the increase
+    uint32_t dropped() const { return dropped_lines; }
+
+private:
+    char* buf;
+    size_t capacity;
+    size_t head = 0;            // first unread byte
+    size_t tail = 0;            // end of buffered data
+    bool discarding = false;    // inside an oversized line, skip to its newline
+    uint32_t dropped_lines = 0;
+};
+
+template <size_t N = STRATUM_LINE_MAX>
+class StratumLineBuffer : public StratumLineReader {
+public:
+    StratumLineBuffer() : StratumLineReader(storage, N) {}
+    StratumLineBuffer(const StratumLineBuffer&) = delete;
+    StratumLineBuffer& operator=(const StratumLineBuffer&) = delete;
+
+private:
+    char storage[N];
+};
+
+// ----------------------------------------------------------------------------
+// TOKENIZER
+// One token per JSON value (object keys included), in document order. A
+// token's `next` is the index just past its subtree, so siblings are walked
+// without recursion. After parse() every string and primitive is
+// NUL-terminated inside the line.
+// ----------------------------------------------------------------------------
+enum JsonType : uint8_t {
+    JSON_PRIMITIVE,     // number, true, false, null
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT
+};
+
+struct JsonToken {
+    JsonType type;
+    uint16_t start;     // first char (strings: after the quote)
+    uint16_t end;       // one past the last char (strings: the closing quote)
+    uint16_t size;      // direct children, keys and values counted separately
+    uint16_t next;      // index of the token after this subtree
+};
+
+class StratumMessage {
+public:
+    // Tokenize a line in place; false on malformed JSON or too many tokens
+    bool parse(char* line, size_t len);
+
+    int root() const { return count ? 0 : -1; }
+    // Value for `key` in an object, -1 if absent
+    int find(int object, const char* key) const;
+    // Element `index` of an array, -1 if out of range
+    int at(int array, size_t index) const;
+    size_t size(int tok) const;
+
+    bool isNull(int tok) const;
+    bool isArray(int tok) const { return tok >= 0 && tokens[tok].type == JSON_ARRAY; }
+    bool isString(int tok) const { return tok >= 0 && tokens[tok].type == JSON_STRING; }
+    // Text of a string or primitive as written (strings without quotes)
+    const char* raw(int tok, const char* fallback = "") const;
+    // String contents, or `fallback` if tok is missing or not a string
+    const char* str(int tok, const char* fallback = "") const;
+    size_t strLength(int tok) const;
+    long integer(int tok, long fallback = 0) const;
+    double number(int tok, double fallback = 0) const;
+    bool boolean(int tok, bool fallback = false) const;
+
+private:
+    char* text = nullptr;
+    JsonToken tokens[STRATUM_MAX_TOKENS];
+    uint16_t count = 0;
+};
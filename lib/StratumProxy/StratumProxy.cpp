@@ -0,0 +1,317 @@
+// ============================================================================
+// StratumProxy.cpp - local stratum server for the swarm's S3 miners
+// ============================================================================
+#include "StratumProxy.h"
+#include "configs.h"
+#include "Hex.h"
+
+StratumProxy::StratumProxy(StratumSession& upstream, uint16_t port)
+    : upstream(upstream), server(port) {
+    // send_job may come back smaller; both buffers hold at least job_cap
+    job_cap = STRATUM_LINE_MAX;
+    job_line = (char*)stratumAlloc(job_cap);
+    send_job = (char*)stratumAlloc(job_cap);
+    mutex = xSemaphoreCreateMutex();
+    for (size_t i = 0; i < MAX_DOWNSTREAM; i++) {
+        memset(&miners[i].stats, 0, sizeof(miners[i].stats));
+    }
+}
+
+void StratumProxy::begin() {
+    xTaskCreatePinnedToCore(
+        [](void* param) { ((StratumProxy*)param)->run(); },
+        "Proxy", PROXY_STACK_SIZE, this, PROXY_PRIORITY, &task, 0);
+}
+
+size_t StratumProxy::stats(ProxyMinerStats* out, size_t max) {
+    size_t n = 0;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    for (size_t i = 0; i < MAX_DOWNSTREAM && n < max; i++) {
+        if (miners[i].stats.ip) out[n++] = miners[i].stats;
+    }
+    xSemaphoreGive(mutex);
+    return n;
+}
+
+// ----------------------------------------------------------------------------
+// UPSTREAM EVENTS
+// Jobs are copied as the pool sent them: downstream coinbases have the same
+// layout, only extranonce1 is longer and extranonce2 shorter by the suffix.
+// ----------------------------------------------------------------------------
+void StratumProxy::poolLine(const char* line, size_t len) {
+    bool is_job = strstr(line, "\"mining.notify\"") != nullptr;
+    if (is_job && len >= job_cap) {
+        Serial.println("Proxy: dropped a notify longer than the job buffer");
+        return;
+    }
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    if (is_job) {
+        memcpy(job_line, line, len);
+        job_len = len;
+        job_seq++;
+    } else if (!is_job && len < sizeof(diff_line)) {
+        memcpy(diff_line, line, len);
+        diff_len = len;
+        diff_seq++;
+    }
+    xSemaphoreGive(mutex);
+    if (task) xTaskNotifyGive(task);  // push right away, not on the next poll
+}
+
+void StratumProxy::shareResult(uint8_t origin, bool accepted) {
+    if (origin == 0 || origin > MAX_DOWNSTREAM) return;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    ProxyMinerStats& s = miners[origin - 1].stats;
+    if (accepted) s.accepted++;
+    else s.rejected++;
+    xSemaphoreGive(mutex);
+}
+
+// Downstream extranonce1 was derived from the lost session: make every
+// miner reconnect and subscribe again once upstream is back
+void StratumProxy::sessionLost() {
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    job_len = 0;
+    job_seq++;      // push() drops its copies too
+    diff_len = 0;
+    diff_seq++;
+    xSemaphoreGive(mutex);
+    drop_all = true;
+}
+
+// ----------------------------------------------------------------------------
+// SERVER TASK
+// ----------------------------------------------------------------------------
+void StratumProxy::run() {
+    server.begin();
+    server.setNoDelay(true);
+
+    while (true) {
+        if (drop_all) {
+            drop_all = false;
+            for (size_t i = 0; i < MAX_DOWNSTREAM; i++) {
+                if (miners[i].active) close(miners[i]);
+            }
+        }
+        acceptMiners();
+        for (uint8_t i = 0; i < MAX_DOWNSTREAM; i++) {
+            if (miners[i].active) serve(i);
+        }
+        // Woken early by poolLine() when there is a job to push
+        ulTaskNotifyTake(pdTRUE, 10 / portTICK_PERIOD_MS);
+    }
+}
+
+void StratumProxy::acceptMiners() {
+    WiFiClient client = server.available();
+    if (!client) return;
+
+    for (size_t i = 0; i < MAX_DOWNSTREAM; i++) {
+        Downstream& m = miners[i];
+        if (m.active) continue;
+        m.client = client;
+        m.client.setNoDelay(true);
+        m.reader.reset();
+        m.active = true;
+        m.subscribed = false;
+        m.authorized = false;
+        m.sent_job = 0;
+        m.sent_diff = 0;
+
+        xSemaphoreTake(mutex, portMAX_DELAY);
+        memset(&m.stats, 0, sizeof(m.stats));
+        m.stats.ip = (uint32_t)client.remoteIP();
+        m.stats.connected = true;
+        xSemaphoreGive(mutex);
+        return;
+    }
+    client.stop();  // every slot taken
+}
+
+void StratumProxy::close(Downstream& m) {
+    m.client.stop();
+    m.active = false;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    m.stats.connected = false;
+    xSemaphoreGive(mutex);
+}
+
+void StratumProxy::serve(uint8_t slot) {
+    Downstream& m = miners[slot];
+    if (!m.client.connected()) {
+        close(m);
+        return;
+    }
+
+    if (m.client.available()) {
+        int n = m.client.read((uint8_t*)m.reader.writePtr(), m.reader.space());
+        if (n > 0) {
+            m.reader.commit(n);
+            char* line;
+            size_t len;
+            while (m.active && (line = m.reader.next(&len)) != nullptr) {
+                handleLine(slot, line, len);
+            }
+            while (m.dropped_logged != m.reader.dropped()) {
+                m.dropped_logged++;
+                Serial.println("Proxy: dropped a miner line longer than PROXY_LINE_MAX");
+            }
+        }
+    }
+    if (m.active) push(m);
+}
+
+// Lines are copied under the mutex, once per new line rather than once per
+// miner, and written after it is released: a slow miner's socket must not
+// hold up the session task in poolLine()
+void StratumProxy::push(Downstream& m) {
+    if (!m.subscribed || !m.authorized) return;
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    if (send_diff_seq != diff_seq) {
+        memcpy(send_diff, diff_line, diff_len);
+        send_diff_len = diff_len;
+        send_diff_seq = diff_seq;
+    }
+    if (send_job_seq != job_seq) {
+        memcpy(send_job, job_line, job_len);
+        send_job_len = job_len;
+        send_job_seq = job_seq;
+    }
+    xSemaphoreGive(mutex);
+
+    if (send_diff_len && m.sent_diff != send_diff_seq) {
+        m.client.write((const uint8_t*)send_diff, send_diff_len);
+        m.client.write((const uint8_t*)"\n", 1);
+        m.sent_diff = send_diff_seq;
+    }
+    if (send_job_len && m.sent_job != send_job_seq) {
+        m.client.write((const uint8_t*)send_job, send_job_len);
+        m.client.write((const uint8_t*)"\n", 1);
+        m.sent_job = send_job_seq;
+    }
+}
+
+// ----------------------------------------------------------------------------
+// DOWNSTREAM REQUESTS
+// ----------------------------------------------------------------------------
+void StratumProxy::handleLine(uint8_t slot, char* line, size_t len) {
+    Downstream& m = miners[slot];
+    if (!msg.parse(line, len)) {
+        Serial.println("Proxy: dropped a miner line that is not valid JSON");
+        return;
+    }
+    int root = msg.root();
+
+    // Echo the request id back exactly as the miner sent it
+    char id[40];
+    int id_tok = msg.find(root, "id");
+    if (msg.isString(id_tok)) snprintf(id, sizeof(id), "\"%s\"", msg.str(id_tok));
+    else snprintf(id, sizeof(id), "%s", msg.raw(id_tok, "null"));
+
+    const char* method = msg.str(msg.find(root, "method"));
+    int params = msg.find(root, "params");
+    char reply[256];
+
+    if (!strcmp(method, "mining.subscribe")) {
+        char en1[2 * MAX_EXTRANONCE1 + 1];
+        uint8_t en2_size;
+        // The suffix comes out of upstream extranonce2; the value is kept
+        // in 64 bits, so at most 8 bytes of it can be shared out
+        if (!upstream.subscription(en1, sizeof(en1), &en2_size) || en2_size < 2 || en2_size > 8) {
+            snprintf(reply, sizeof(reply),
+                "{\"id\":%s,\"result\":null,\"error\":[20,\"Upstream not ready\",null]}\n", id);
+            m.client.print(reply);
+            close(m);
+            return;
+        }
+        uint8_t suffix = PROXY_FIRST_SUFFIX + slot;
+        snprintf(reply, sizeof(reply),
+            "{\"id\":%s,\"result\":[[[\"mining.set_difficulty\",\"%02x\"],[\"mining.notify\",\"%02x\"]],"
+            "\"%s%02x\",%u],\"error\":null}\n",
+            id, suffix, suffix, en1, suffix, (unsigned)(en2_size - 1));
+        m.subscribed = true;
+    } else if (!strcmp(method, "mining.authorize")) {
+        xSemaphoreTake(mutex, portMAX_DELAY);
+        strncpy(m.stats.worker, msg.str(msg.at(params, 0)), sizeof(m.stats.worker) - 1);
+        xSemaphoreGive(mutex);
+        m.authorized = true;
+        snprintf(reply, sizeof(reply), "{\"id\":%s,\"result\":true,\"error\":null}\n", id);
+    } else if (!strcmp(method, "mining.configure")) {
+        uint32_t mask = upstream.versionMask();
+        if (mask) {
+            snprintf(reply, sizeof(reply),
+                "{\"id\":%s,\"result\":{\"version-rolling\":true,\"version-rolling.mask\":\"%08lx\"},\"error\":null}\n",
+                id, (unsigned long)mask);
+        } else {
+            snprintf(reply, sizeof(reply),
+                "{\"id\":%s,\"result\":{\"version-rolling\":false},\"error\":null}\n", id);
+        }
+    } else if (!strcmp(method, "mining.submit")) {
+        handleSubmit(slot, params, reply, sizeof(reply), id);
+    } else if (!msg.isNull(id_tok)) {
+        // extranonce.subscribe, suggest_difficulty, ...: not supported
+        snprintf(reply, sizeof(reply), "{\"id\":%s,\"result\":false,\"error\":null}\n", id);
+    } else {
+        return;
+    }
+    m.client.print(reply);
+}
+
+// Relay a downstream share: its extranonce2 goes behind the miner's suffix
+// byte, and the upstream verdict is credited back to the slot
+void StratumProxy::handleSubmit(uint8_t slot, int params, char* reply, size_t cap, const char* id) {
+    Downstream& m = miners[slot];
+    int error = 0;
+    const char* message = nullptr;
+
+    char en1[2 * MAX_EXTRANONCE1 + 1];
+    uint8_t en2_size;
+    uint32_t generation = 0;
+    uint32_t ntime, nonce, version_bits = 0;
+    uint8_t en2[8];
+    int en2_tok = msg.at(params, 2);
+    int version_tok = msg.at(params, 5);
+
+    if (!m.authorized || !upstream.subscription(en1, sizeof(en1), &en2_size) ||
+        en2_size < 2 || en2_size > 8) {
+        error = 24; message = "Unauthorized worker";
+    } else if (msg.strLength(en2_tok) != 2u * (en2_size - 1) ||
+               !hex_decode(msg.str(en2_tok), msg.strLength(en2_tok), en2) ||
+               !hex_to_u32(msg.str(msg.at(params, 3)), &ntime) ||
+               !hex_to_u32(msg.str(msg.at(params, 4)), &nonce) ||
+               (version_tok >= 0 && !hex_to_u32(msg.str(version_tok), &version_bits))) {
+        error = 20; message = "Malformed share";
+    } else if ((generation = upstream.findJob(msg.str(msg.at(params, 1)))) == 0) {
+        error = 21; message = "Job not found";
+    }
+
+    if (!error) {
+        ShareSubmission sub;
+        sub.generation = generation;
+        sub.nonce = nonce;
+        sub.version_bits = version_bits & upstream.versionMask();
+        sub.ntime = ntime;
+        sub.extranonce2 = (uint64_t)(PROXY_FIRST_SUFFIX + slot) << (8 * (en2_size - 1));
+        for (uint8_t i = 0; i < en2_size - 1; i++) {
+            sub.extranonce2 |= (uint64_t)en2[i] << (8 * (en2_size - 2 - i));
+        }
+        sub.origin = slot + 1;
+        sub.valid = false;
+        if (!upstream.submit(sub)) {
+            error = 20; message = "Busy";
+        }
+    }
+
+    xSemaphoreTake(mutex, portMAX_DELAY);
+    m.stats.submitted++;
+    m.stats.last_share_ms = millis();
+    if (error) m.stats.rejected++;
+    xSemaphoreGive(mutex);
+
+    // Accepted here means relayed; the pool's answer lands in the stats
+    if (error) {
+        snprintf(reply, cap, "{\"id\":%s,\"result\":null,\"error\":[%d,\"%s\",null]}\n", id, error, message);
+    } else {
+        snprintf(reply, cap, "{\"id\":%s,\"result\":true,\"error\":null}\n", id);
+    }
+}
@@ -0,0 +1,87 @@
+// ============================================================================
+// StratumProxy.h - local stratum server for the swarm's S3 miners
+// Every downstream miner shares the dashboard's one upstream session. Each
+// gets extranonce1 = upstream extranonce1 + a one-byte suffix, so its
+// coinbases can never collide with another miner's or a local thread's.
+// ============================================================================
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+#include "Stratum.h"
+
+static const size_t MAX_DOWNSTREAM = MAX_MINERS;
+static const size_t PROXY_LINE_MAX = 512;         // downstream only sends short requests
+static const uint8_t PROXY_FIRST_SUFFIX = 0x10;   // lower values are local worker indexes
+
+// Exact per-miner share data, as judged by the upstream pool
+struct ProxyMinerStats {
+    char worker[48];
+    uint32_t ip;
+    bool connected;
+    uint32_t submitted;
+    uint32_t accepted;
+    uint32_t rejected;        // including stale and never answered
+    unsigned long last_share_ms;
+};
+
+class StratumProxy : public StratumListener {
+public:
+    StratumProxy(StratumSession& upstream, uint16_t port);
+    void begin();               // starts the server task
+
+    // Copies the stats of every slot that has seen a miner; returns the count
+    size_t stats(ProxyMinerStats* out, size_t max);
+
+    // StratumListener, called on the session task
+    void poolLine(const char* line, size_t len) override;
+    void shareResult(uint8_t origin, bool accepted) override;
+    void sessionLost() override;
+
+private:
+    struct Downstream {
+        WiFiClient client;
+        StratumLineBuffer<PROXY_LINE_MAX> reader;
+        uint32_t dropped_logged = 0;
+        bool active = false;
+        bool subscribed = false;
+        bool authorized = false;
+        uint32_t sent_job = 0;        // job_seq / diff_seq last sent
+        uint32_t sent_diff = 0;
+        ProxyMinerStats stats;        // guarded by mutex
+    };
+
+    StratumSession& upstream;
+    WiFiServer server;
+    SemaphoreHandle_t mutex;
+    TaskHandle_t task = nullptr;
+    Downstream miners[MAX_DOWNSTREAM];
+    StratumMessage msg;               // proxy task only
+
+    // Latest upstream lines, pushed to every miner and replayed to new ones;
+    // guarded by mutex
+    char* job_line;                   // job_cap bytes
+    size_t job_cap;
+    size_t job_len = 0;
+    uint32_t job_seq = 0;
+    char diff_line[160];
+    size_t diff_len = 0;
+    uint32_t diff_seq = 0;
+    volatile bool drop_all = false;
+
+    // Proxy task only: what push() writes, copied out of the lines above so
+    // no socket write ever holds the mutex poolLine() needs
+    char* send_job;                   // job_cap bytes
+    size_t send_job_len = 0;
+    uint32_t send_job_seq = 0;
+    char send_diff[160];
+    size_t send_diff_len = 0;
+    uint32_t send_diff_seq = 0;
+
+    void run();
+    void acceptMiners();
+    void serve(uint8_t slot);
+    void push(Downstream& m);
+    void handleLine(uint8_t slot, char* line, size_t len);
+    void handleSubmit(uint8_t slot, int params, char* reply, size_t cap, const char* id);
+    void close(Downstream& m);
+};
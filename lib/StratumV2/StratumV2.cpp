@@ -0,0 +1,623 @@
+// ============================================================================
+// StratumV2.cpp - Stratum V2 mining protocol client over standard channels
+// ============================================================================
+#include "StratumV2.h"
+#include "configs.h"
+#include <math.h>
+
+// ----------------------------------------------------------------------------
+// CODEC
+// ----------------------------------------------------------------------------
+uint8_t Sv2Reader::u8() {
+    if (!left) { ok = false; return 0; }
+    left--;
+    return *p++;
+}
+
+uint32_t Sv2Reader::u32() {
+    if (left < 4) { ok = false; left = 0; return 0; }
+    uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+    p += 4;
+    left -= 4;
+    return v;
+}
+
+uint64_t Sv2Reader::u64() {
+    uint64_t lo = u32();
+    return lo | ((uint64_t)u32() << 32);
+}
+
+void Sv2Reader::bytes(uint8_t* out, size_t n) {
+    if (left < n) { ok = false; left = 0; memset(out, 0, n); return; }
+    memcpy(out, p, n);
+    p += n;
+    left -= n;
+}
+
+size_t Sv2Reader::var(uint8_t* out, size_t cap, bool text) {
+    size_t n = u8();
+    if (left < n) { ok = false; left = 0; n = 0; }
+    size_t keep = (n + (text ? 1 : 0) <= cap) ? n : 0;
+    memcpy(out, p, keep);
+    if (text && cap) out[keep] = '\0';
+    p += n;
+    left -= n;
+    return keep;
+}
+
+void Sv2Writer::frame(uint16_t extension, uint8_t type) {
+    len = 0;
+    u16(extension);
+    u8(type);
+    u8(0); u8(0); u8(0);    // payload length, see end()
+}
+
+size_t Sv2Writer::end() {
+    if (len > cap) return 0;
+    size_t payload = len - SV2_HEADER_SIZE;
+    buf[3] = payload & 0xFF;
+    buf[4] = (payload >> 8) & 0xFF;
+    buf[5] = (payload >> 16) & 0xFF;
+    return len;
+}
+
+void Sv2Writer::u8(uint8_t v) {
+    if (len < cap) buf[len] = v;
+    len++;
+}
+
+void Sv2Writer::u16(uint16_t v) {
+    u8(v & 0xFF);
+    u8(v >> 8);
+}
+
+void Sv2Writer::u32(uint32_t v) {
+    u16(v & 0xFFFF);
+    u16(v >> 16);
+}
+
+void Sv2Writer::f32(float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, 4);
+    u32(bits);
+}
+
+void Sv2Writer::bytes(const uint8_t* data, size_t n) {
+    for (size_t i = 0; i < n; i++) u8(data[i]);
+}
+
+void Sv2Writer::str(const char* s) {
+    size_t n = strlen(s);
+    if (n > 255) n = 255;
+    u8(n);
+    bytes((const uint8_t*)s, n);
+}
+
+// Pool difficulty for a little-endian share target, for display only
+static double targetToDifficulty(const uint8_t* target) {
+    double value = 0;
+    for (int i = 31; i >= 0; i--) value = value * 256.0 + target[i];
+    return (value > 0) ? 65535.0 * ldexp(1.0, 208) / value : 0;
+}
+
+// ----------------------------------------------------------------------------
+// SESSION
+// ----------------------------------------------------------------------------
+Sv2Session::Sv2Session(uint8_t workers) {
+    channel_count = constrain(workers, (uint8_t)1, (uint8_t)SV2_MAX_CHANNELS);
+    memset(host, 0, sizeof(host));
+    memset(channels, 0, sizeof(channels));
+    history.clear();
+    memset(pending, 0, sizeof(pending));
+    memset(&job, 0, sizeof(job));
+    jobMutex = xSemaphoreCreateMutex();
+    shareQueue = xQueueCreate(10, sizeof(ShareSubmission));
+}
+
+void Sv2Session::setPool(const char* pool_host, uint16_t pool_port) {
+    strncpy(host, pool_host, sizeof(host) - 1);
+    port = pool_port;
+}
+
+void Sv2Session::begin() {
+    xTaskCreatePinnedToCore(
+        [](void* param) { ((Sv2Session*)param)->run(); },
+        "StratumV2", STRATUM_STACK_SIZE, this, STRATUM_PRIORITY, nullptr, 0);
+}
+
+// ----------------------------------------------------------------------------
+// SESSION TASK
+// Same shape as the V1 session: one task owns the socket, reads frames and
+// writes the workers' shares.
+// ----------------------------------------------------------------------------
+void Sv2Session::run() {
+    while (true) {
+        if (!client.connect(host, port, POOL_CONNECT_TIMEOUT_MS)) {
+            backoff();
+            continue;
+        }
+        client.setNoDelay(true);
+        resetConnection();
+        is_connected = true;
+        setupConnection();
+        unsigned long connected_at = millis();
+        bool silent = false;
+
+        while (client.connected()) {
+            // A pool that takes the connection and then says nothing would
+            // otherwise hold us forever: count it as failed and back off
+            if (!handshakeDone() && millis() - connected_at > POOL_HANDSHAKE_TIMEOUT_MS) {
+                Serial.println("SV2: pool did not answer setup or open the channels, disconnecting");
+                silent = true;
+                break;
+            }
+            sendShares();
+            expireSubmits(false);
+            if (client.available()) {
+                readFrames();
+            } else {
+                vTaskDelay(10 / portTICK_PERIOD_MS);
+            }
+            publishJobs();
+        }
+
+        expireSubmits(true);
+        is_connected = false;
+        xSemaphoreTake(jobMutex, portMAX_DELAY);
+        job_ready = false;
+        invalidateJobs(false);
+        history.clear();
+        xSemaphoreGive(jobMutex);
+        client.stop();
+
+        if (silent || millis() - connected_at < POOL_STABLE_MS) {
+            backoff();
+        } else {
+            failures = 0;
+        }
+    }
+}
+
+// Same schedule as the V1 pools: doubling, capped, +-50% jitter
+void Sv2Session::backoff() {
+    if (failures < 16) failures++;
+    unsigned long wait = POOL_BACKOFF_BASE_MS << (failures - 1);
+    if (wait > POOL_BACKOFF_MAX_MS || failures > 16) wait = POOL_BACKOFF_MAX_MS;
+    wait = wait / 2 + esp_random() % (wait + 1);
+    vTaskDelay(wait / portTICK_PERIOD_MS);
+}
+
+// SetupConnection.Success came back and every channel is open
+bool Sv2Session::handshakeDone() const {
+    for (uint8_t i = 0; i < channel_count; i++) {
+        if (!channels[i].open) return false;
+    }
+    return true;
+}
+
+void Sv2Session::resetConnection() {
+    memset(channels, 0, sizeof(channels));
+    has_prevhash = false;
+    rx_header_len = 0;
+    rx_need = rx_got = 0;
+}
+
+void Sv2Session::setupConnection() {
+    uint8_t buf[160];
+    Sv2Writer out(buf, sizeof(buf));
+    out.frame(0, SV2_SETUP_CONNECTION);
+    out.u8(0);                      // mining protocol
+    out.u16(2);                     // min_version
+    out.u16(2);                     // max_version
+    out.u32(SV2_REQUIRES_STANDARD_JOBS);
+    out.str(host);
+    out.u16(port);
+    out.str("SoloSwarm");           // vendor
+    out.str("ESP32");               // hardware_version
+    out.str(STRATUM_USER_AGENT);    // firmware
+    out.str("");                    // device_id
+    size_t n = out.end();
+    if (n) client.write(buf, n);
+}
+
+// One standard channel per worker; request_id is the worker index
+void Sv2Session::openChannels() {
+    uint8_t buf[128];
+    uint8_t max_target[32];
+    memset(max_target, 0xFF, sizeof(max_target));
+
+    for (uint8_t i = 0; i < channel_count; i++) {
+        Sv2Writer out(buf, sizeof(buf));
+        out.frame(0, SV2_OPEN_STANDARD_CHANNEL);
+        out.u32(i);
+        out.str(ADDRESS);
+        out.f32(SV2_NOMINAL_HASHRATE);
+        out.bytes(max_target, 32);
+        size_t n = out.end();
+        if (n) client.write(buf, n);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// FRAMES
+// Header first, then the payload straight into a fixed buffer. Frames too
+// big for it (extended jobs, which we never ask for) are read and dropped.
+// ----------------------------------------------------------------------------
+void Sv2Session::readFrames() {
+    while (client.available()) {
+        if (rx_header_len < SV2_HEADER_SIZE) {
+            int n = client.read(rx_header + rx_header_len, SV2_HEADER_SIZE - rx_header_len);
+            if (n <= 0) return;
+            rx_header_len += n;
+            if (rx_header_len < SV2_HEADER_SIZE) continue;
+            rx_need = rx_header[3] | (rx_header[4] << 8) | (rx_header[5] << 16);
+            rx_got = 0;
+        }
+
+        if (rx_got < rx_need) {
+            size_t want = rx_need - rx_got;
+            uint8_t* dst = rx_payload + ((rx_need <= SV2_FRAME_MAX) ? rx_got : 0);
+            if (want > SV2_FRAME_MAX) want = SV2_FRAME_MAX;
+            int n = client.read(dst, want);
+            if (n <= 0) return;
+            rx_got += n;
+            if (rx_got < rx_need) continue;
+        }
+
+        uint16_t extension = (rx_header[0] | (rx_header[1] << 8)) & ~SV2_CHANNEL_MSG;
+        if (extension == 0 && rx_need <= SV2_FRAME_MAX) {
+            handleFrame(rx_header[2], rx_payload, rx_need);
+        }
+        rx_header_len = 0;
+    }
+}
+
+void Sv2Session::handleFrame(uint8_t type, const uint8_t* data, size_t len) {
+    Sv2Reader in(data, len);
+    char reason[64];
+
+    switch (type) {
+        case SV2_SETUP_CONNECTION_SUCCESS:
+            openChannels();
+            break;
+
+        case SV2_SETUP_CONNECTION_ERROR:
+            in.u32();   // flags
+            in.var((uint8_t*)reason, sizeof(reason), true);
+            Serial.println("SV2 setup refused:");
+            Serial.println(reason);
+            client.stop();
+            break;
+
+        case SV2_OPEN_STANDARD_CHANNEL_OK: {
+            uint32_t request = in.u32();
+            uint32_t id = in.u32();
+            uint8_t target[32];
+            in.bytes(target, 32);
+            // extranonce_prefix and group_channel_id: standard jobs carry
+            // the finished merkle root, so neither is needed here
+            if (!in.ok || request >= channel_count) break;
+            Channel& ch = channels[request];
+            ch.id = id;
+            ch.open = true;
+            memcpy(ch.target, target, 32);
+            break;
+        }
+
+        case SV2_OPEN_CHANNEL_ERROR:
+        case SV2_CLOSE_CHANNEL:
+            // A worker without a channel has nothing to mine: start over
+            in.u32();
+            in.var((uint8_t*)reason, sizeof(reason), true);
+            Serial.println("SV2 channel lost:");
+            Serial.println(reason);
+            client.stop();
+            break;
+
+        case SV2_NEW_MINING_JOB:
+            handleNewJob(in);
+            break;
+
+        case SV2_SET_NEW_PREV_HASH:
+            handleNewPrevHash(in);
+            break;
+
+        case SV2_SET_TARGET: {
+            // Applies from the next published job, like mining.set_difficulty
+            Channel* ch = findChannel(in.u32());
+            uint8_t target[32];
+            in.bytes(target, 32);
+            if (ch && in.ok) memcpy(ch->target, target, 32);
+            break;
+        }
+
+        case SV2_SUBMIT_SHARES_SUCCESS:
+            handleSubmitSuccess(in);
+            break;
+
+        case SV2_SUBMIT_SHARES_ERROR:
+            handleSubmitError(in);
+            break;
+
+        case SV2_RECONNECT:
+            // Moving to another host is not supported: reconnect to ours
+            client.stop();
+            break;
+
+        default:
+            break;
+    }
+}
+
+Sv2Session::Channel* Sv2Session::findChannel(uint32_t id) {
+    for (uint8_t i = 0; i < channel_count; i++) {
+        if (channels[i].open && channels[i].id == id) return &channels[i];
+    }
+    return nullptr;
+}
+
+// ----------------------------------------------------------------------------
+// JOBS
+// A job with min_ntime is live for the current prevhash; without, it waits
+// for the SetNewPrevHash that names it. Channels are updated one message at
+// a time, so jobs are published once every channel has its new one (or
+// after SV2_JOB_BATCH_MS) as one generation.
+// ----------------------------------------------------------------------------
+void Sv2Session::handleNewJob(Sv2Reader& in) {
+    Channel* ch = findChannel(in.u32());
+    ChannelJob next;
+    next.job_id = in.u32();
+    bool future = !in.u8();
+    next.ntime = future ? 0 : in.u32();
+    next.version = in.u32();
+    size_t root_len = in.var(next.merkle_root, sizeof(next.merkle_root));
+    if (!ch || !in.ok || root_len != 32) return;
+
+    if (future) {
+        ch->future[ch->future_next] = next;
+        ch->future_next = (ch->future_next + 1) % SV2_FUTURE_JOBS;
+        if (ch->future_count < SV2_FUTURE_JOBS) ch->future_count++;
+        return;
+    }
+    if (!has_prevhash) return;
+    ch->staged = next;
+    ch->has_job = true;
+    if (!ch->dirty) {
+        bool any = false;
+        for (uint8_t i = 0; i < channel_count; i++) any |= channels[i].dirty;
+        if (!any) dirty_since = millis();
+        ch->dirty = true;
+    }
+}
+
+void Sv2Session::handleNewPrevHash(Sv2Reader& in) {
+    Channel* ch = findChannel(in.u32());
+    uint32_t job_id = in.u32();
+    uint8_t hash[32];
+    in.bytes(hash, 32);
+    uint32_t min_ntime = in.u32();
+    uint32_t bits = in.u32();
+    if (!ch || !in.ok) return;
+
+    if (!has_prevhash || memcmp(hash, prevhash, 32) != 0) {
+        // New block: everything mined so far is worthless, as with a clean
+        // V1 notify. Channels wait for their own new job before mining.
+        xSemaphoreTake(jobMutex, portMAX_DELAY);
+        job_ready = false;
+        invalidateJobs(true);
+        xSemaphoreGive(jobMutex);
+        memcpy(prevhash, hash, 32);
+        nbits = bits;
+        has_prevhash = true;
+        for (uint8_t i = 0; i < channel_count; i++) {
+            channels[i].has_job = false;
+            channels[i].dirty = false;
+        }
+        dirty_since = millis();
+    }
+
+    for (size_t i = 0; i < ch->future_count; i++) {
+        if (ch->future[i].job_id == job_id) {
+            ch->staged = ch->future[i];
+            ch->staged.ntime = min_ntime;
+            ch->has_job = true;
+            ch->dirty = true;
+            break;
+        }
+    }
+}
+
+void Sv2Session::publishJobs() {
+    bool any_dirty = false;
+    bool all_dirty = true;
+    for (uint8_t i = 0; i < channel_count; i++) {
+        const Channel& ch = channels[i];
+        if (!ch.open || !ch.has_job) return;
+        any_dirty |= ch.dirty;
+        all_dirty &= ch.dirty;
+    }
+    if (!any_dirty) return;
+    if (!all_dirty && millis() - dirty_since < SV2_JOB_BATCH_MS) return;
+
+    xSemaphoreTake(jobMutex, portMAX_DELAY);
+    memcpy(job.prevhash, prevhash, 32);
+    job.nbits = nbits;
+    nbitsToTarget(nbits, job.target);
+    job.clean_jobs = !job_ready;
+    job.extranonce2_size = 0;
+    job.version_mask = VERSION_ROLLING_MASK;  // BIP 320 bits are the device's to roll
+    job.merkle_count = 0;
+    job.header_only = true;
+
+    uint32_t generation = job_generation.load() + 1;
+    JobRecord& record = history.add(generation, *this);
+    for (uint8_t i = 0; i < channel_count; i++) {
+        record.jobs[i] = channels[i].staged;
+        // A share target harder than the block target would hide blocks
+        const uint8_t* target = targetBelow(channels[i].target, job.target) ? job.target : channels[i].target;
+        memcpy(record.share_targets[i], target, 32);
+        channels[i].dirty = false;
+    }
+    job.generation = generation;
+    job_generation.store(generation, std::memory_order_release);
+    job_ready = true;
+    xSemaphoreGive(jobMutex);
+
+    templates.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool Sv2Session::copyJob(StratumJob* out, uint8_t worker) {
+    if (!job_ready) return false;
+    xSemaphoreTake(jobMutex, portMAX_DELAY);
+    const JobRecord* record = history.find(job.generation);
+    bool ok = job_ready && record;
+    if (ok) {
+        uint8_t channel = worker % channel_count;
+        const ChannelJob& cj = record->jobs[channel];
+        *out = job;
+        snprintf(out->job_id, sizeof(out->job_id), "%lu", (unsigned long)cj.job_id);
+        out->version = cj.version;
+        out->ntime = cj.ntime;
+        memcpy(out->merkle_root, cj.merkle_root, 32);
+        memcpy(out->share_target, record->share_targets[channel], 32);
+        out->difficulty = targetToDifficulty(out->share_target);
+    }
+    xSemaphoreGive(jobMutex);
+    return ok;
+}
+
+// Standard jobs come with their merkle root (job.merkle_root): there is no
+// coinbase here to hash
+bool Sv2Session::merkleRoot(uint32_t /*generation*/, const uint8_t* /*extranonce2*/, uint8_t* /*root*/) {
+    return false;
+}
+
+// ----------------------------------------------------------------------------
+// SHARE SUBMISSION
+// A share goes out on its worker's channel as SubmitSharesStandard. The pool
+// acknowledges in batches: Success covers every sequence number up to the
+// one it names, Error names a single share.
+// ----------------------------------------------------------------------------
+bool Sv2Session::submit(const ShareSubmission& share) {
+    return xQueueSend(shareQueue, &share, 0) == pdTRUE;  // Non-blocking
+}
+
+void Sv2Session::sendShares() {
+    ShareSubmission sub;
+    uint8_t buf[SV2_HEADER_SIZE + 24];
+
+    while (xQueueReceive(shareQueue, &sub, 0)) {
+        uint8_t channel = sub.extranonce2 % channel_count;
+        // As in V1: flushed jobs only for block candidates
+        xSemaphoreTake(jobMutex, portMAX_DELAY);
+        const JobRecord* record = history.find(sub.generation);
+        bool known = record && (sub.valid || !isStale(sub.generation));
+        ChannelJob cj;
+        if (known) cj = record->jobs[channel];
+        xSemaphoreGive(jobMutex);
+
+        Channel& ch = channels[channel];
+        if (!known || !ch.open) {
+            if (sub.valid) Serial.println("SV2: block candidate for a forgotten job or closed channel dropped");
+            continue;
+        }
+
+        uint32_t sequence = ch.sequence;
+        uint32_t version = (cj.version & ~VERSION_ROLLING_MASK) | (sub.version_bits & VERSION_ROLLING_MASK);
+        Sv2Writer out(buf, sizeof(buf));
+        out.frame(SV2_CHANNEL_MSG, SV2_SUBMIT_SHARES_STANDARD);
+        out.u32(ch.id);
+        out.u32(sequence);
+        out.u32(cj.job_id);
+        out.u32(sub.nonce);
+        out.u32(sub.ntime ? sub.ntime : cj.ntime);
+        out.u32(version);
+        size_t n = out.end();
+        if (!n) {
+            // Never leave the pool a partial frame; the sequence number stays unused
+            Serial.println(sub.valid ? "SV2: block candidate did not fit its frame, dropped"
+                                     : "SV2: share did not fit its frame, dropped");
+            continue;
+        }
+        ch.sequence++;
+        client.write(buf, n);
+        trackSubmit(channel, sequence, sub.generation);
+
+        if (sub.valid) announceBlock();
+    }
+}
+
+void Sv2Session::trackSubmit(uint8_t channel, uint32_t sequence, uint32_t generation) {
+    // Free slot, or else the oldest one: that share has waited longest
+    PendingSubmit* slot = &pending[0];
+    for (size_t i = 0; i < MAX_PENDING_SUBMITS; i++) {
+        if (!pending[i].used) { slot = &pending[i]; break; }
+        if ((long)(pending[i].sent_ms - slot->sent_ms) < 0) slot = &pending[i];
+    }
+
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    if (slot->used) submitStats.timed_out++;
+    submitStats.sent++;
+    xSemaphoreGive(statsMutex);
+
+    slot->used = true;
+    slot->channel = channel;
+    slot->sequence = sequence;
+    slot->generation = generation;
+    slot->sent_ms = millis();
+}
+
+void Sv2Session::handleSubmitSuccess(Sv2Reader& in) {
+    Channel* ch = findChannel(in.u32());
+    uint32_t last_sequence = in.u32();
+    if (!ch || !in.ok) return;
+
+    uint8_t channel = ch - channels;
+    unsigned long now = millis();
+    for (size_t i = 0; i < MAX_PENDING_SUBMITS; i++) {
+        PendingSubmit& p = pending[i];
+        if (p.used && p.channel == channel && (int32_t)(p.sequence - last_sequence) <= 0) {
+            p.used = false;
+            recordSubmitResult(now - p.sent_ms, true, 0, false);
+        }
+    }
+}
+
+// SV2 error strings mapped onto the V1 codes submitStats counts by
+void Sv2Session::handleSubmitError(Sv2Reader& in) {
+    Channel* ch = findChannel(in.u32());
+    uint32_t sequence = in.u32();
+    char code[48];
+    in.var((uint8_t*)code, sizeof(code), true);
+    if (!ch || !in.ok) return;
+
+    int error = 20;
+    if (!strcmp(code, "stale-share") || !strcmp(code, "invalid-job-id")) error = 21;
+    else if (!strcmp(code, "duplicate-share")) error = 22;
+    else if (!strcmp(code, "difficulty-too-low")) error = 23;
+
+    uint8_t channel = ch - channels;
+    for (size_t i = 0; i < MAX_PENDING_SUBMITS; i++) {
+        PendingSubmit& p = pending[i];
+        if (p.used && p.channel == channel && p.sequence == sequence) {
+            p.used = false;
+            recordSubmitResult(millis() - p.sent_ms, false, error, isStale(p.generation));
+            break;
+        }
+    }
+}
+
+void Sv2Session::expireSubmits(bool all) {
+    unsigned long now = millis();
+    uint32_t expired = 0;
+    for (size_t i = 0; i < MAX_PENDING_SUBMITS; i++) {
+        if (pending[i].used && (all || now - pending[i].sent_ms > SUBMIT_TIMEOUT_MS)) {
+            pending[i].used = false;
+            expired++;
+        }
+    }
+    if (!expired) return;
+    xSemaphoreTake(statsMutex, portMAX_DELAY);
+    submitStats.timed_out += expired;
+    xSemaphoreGive(statsMutex);
+}
@@ -0,0 +1,173 @@
+// ============================================================================
+// StratumV2.h - Stratum V2 mining protocol client over standard channels
+// Binary frames and header-only jobs: the pool sends every channel its own
+// merkle root, so a new job is a 32-byte copy instead of a JSON parse, a
+// coinbase hash and a merkle walk. Each local worker gets its own standard
+// channel, which keeps their search spaces apart. Frames are plaintext (no
+// Noise handshake), for a local SV2 pool or translator proxy.
+// ============================================================================
+#pragma once
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include "Stratum.h"
+
+static const size_t SV2_MAX_CHANNELS = 4;           // one per local worker
+static const size_t SV2_FRAME_MAX = 256;            // largest payload kept; jobs are ~60 bytes
+static const size_t SV2_HEADER_SIZE = 6;            // extension u16, type u8, length u24
+static const size_t SV2_FUTURE_JOBS = 2;            // per channel, waiting for their prevhash
+static const unsigned long SV2_JOB_BATCH_MS = 100;  // wait for every channel's job before publishing
+
+// Message types used here: common and mining protocol
+enum Sv2MessageType : uint8_t {
+    SV2_SETUP_CONNECTION            = 0x00,
+    SV2_SETUP_CONNECTION_SUCCESS    = 0x01,
+    SV2_SETUP_CONNECTION_ERROR      = 0x02,
+    SV2_OPEN_STANDARD_CHANNEL       = 0x10,
+    SV2_OPEN_STANDARD_CHANNEL_OK    = 0x11,
+    SV2_OPEN_CHANNEL_ERROR          = 0x12,
+    SV2_NEW_MINING_JOB              = 0x15,
+    SV2_CLOSE_CHANNEL               = 0x18,
+    SV2_SUBMIT_SHARES_STANDARD      = 0x1a,
+    SV2_SUBMIT_SHARES_SUCCESS       = 0x1c,
+    SV2_SUBMIT_SHARES_ERROR         = 0x1d,
+    SV2_SET_NEW_PREV_HASH           = 0x20,
+    SV2_SET_TARGET                  = 0x21,
+    SV2_RECONNECT                   = 0x25,
+};
+
+static const uint16_t SV2_CHANNEL_MSG = 0x8000;        // extension_type bit for channel messages
+static const uint32_t SV2_REQUIRES_STANDARD_JOBS = 1;  // SetupConnection flag
+
+// ----------------------------------------------------------------------------
+// CODEC
+// Little-endian fields over one frame. Reading past the end clears ok and
+// yields zeros, so a handler checks once after taking every field.
+// ----------------------------------------------------------------------------
+struct Sv2Reader {
+    const uint8_t* p;
+    size_t left;
+    bool ok = true;
+
+    Sv2Reader(const uint8_t* data, size_t len) : p(data), left(len) {}
+    uint8_t u8();
+    uint32_t u32();
+    uint64_t u64();
+    void bytes(uint8_t* out, size_t n);
+    // STR0_255 / B0_32: length byte + data. Longer than cap is skipped and
+    // reported as length 0; strings are NUL-terminated (cap includes it).
+    size_t var(uint8_t* out, size_t cap, bool text = false);
+};
+
+struct Sv2Writer {
+    uint8_t* buf;
+    size_t cap;
+    size_t len = 0;
+
+    Sv2Writer(uint8_t* out, size_t size) : buf(out), cap(size) {}
+    void frame(uint16_t extension, uint8_t type);  // header, length patched by end()
+    size_t end();                                  // total frame size, 0 if it overflowed
+    void u8(uint8_t v);
+    void u16(uint16_t v);
+    void u32(uint32_t v);
+    void f32(float v);
+    void bytes(const uint8_t* data, size_t n);
+    void str(const char* s);                       // STR0_255
+};
+
+// ----------------------------------------------------------------------------
+// SESSION
+// ----------------------------------------------------------------------------
+class Sv2Session : public JobSource {
+public:
+    // One standard channel per local worker, at most SV2_MAX_CHANNELS
+    explicit Sv2Session(uint8_t workers);
+    void setPool(const char* host, uint16_t port);
+    void begin();               // starts the session task
+
+    bool copyJob(StratumJob* out, uint8_t worker) override;
+    bool merkleRoot(uint32_t generation, const uint8_t* extranonce2, uint8_t* root) override;
+    bool submit(const ShareSubmission& share) override;
+
+private:
+    WiFiClient client;
+    char host[64];
+    uint16_t port = 0;
+    uint8_t failures = 0;
+
+    SemaphoreHandle_t jobMutex;
+    QueueHandle_t shareQueue;
+    volatile bool job_ready = false;
+
+    // A job as the pool sent it to one channel
+    struct ChannelJob {
+        uint32_t job_id;
+        uint32_t version;
+        uint32_t ntime;
+        uint8_t merkle_root[32];
+    };
+
+    // Session task only
+    struct Channel {
+        uint32_t id;
+        bool open;
+        uint8_t target[32];           // share target, little-endian
+        ChannelJob staged;            // newest job for the current prevhash
+        bool has_job;
+        bool dirty;                   // staged is newer than the published job
+        ChannelJob future[SV2_FUTURE_JOBS];
+        uint8_t future_next;
+        uint8_t future_count;
+        uint32_t sequence;            // next share sequence number
+    };
+    Channel channels[SV2_MAX_CHANNELS];
+    uint8_t channel_count;
+    uint8_t prevhash[32];             // current block, header byte order
+    uint32_t nbits = 0;
+    bool has_prevhash = false;
+    unsigned long dirty_since = 0;
+
+    // Every channel's job per generation, for copyJob and the share
+    // encoder; guarded by jobMutex
+    struct JobRecord {
+        uint32_t generation;
+        ChannelJob jobs[SV2_MAX_CHANNELS];
+        uint8_t share_targets[SV2_MAX_CHANNELS][32];
+    };
+    JobHistory<JobRecord> history;
+    StratumJob job;                   // fields shared by every channel
+
+    // Shares waiting for SubmitShares.Success / .Error
+    struct PendingSubmit {
+        bool used;
+        uint8_t channel;
+        uint32_t sequence;
+        uint32_t generation;
+        unsigned long sent_ms;
+    };
+    PendingSubmit pending[MAX_PENDING_SUBMITS];
+
+    // Frame being received
+    uint8_t rx_header[SV2_HEADER_SIZE];
+    size_t rx_header_len = 0;
+    uint8_t rx_payload[SV2_FRAME_MAX];
+    size_t rx_need = 0;               // payload length of the current frame
+    size_t rx_got = 0;
+
+    void run();
+    void backoff();
+    void resetConnection();
+    bool handshakeDone() const;
+    void setupConnection();
+    void openChannels();
+    void readFrames();
+    void handleFrame(uint8_t type, const uint8_t* data, size_t len);
+    void handleNewJob(Sv2Reader& in);
+    void handleNewPrevHash(Sv2Reader& in);
+    void handleSubmitSuccess(Sv2Reader& in);
+    void handleSubmitError(Sv2Reader& in);
+    Channel* findChannel(uint32_t id);
+    void publishJobs();
+    void sendShares();
+    void trackSubmit(uint8_t channel, uint32_t sequence, uint32_t generation);
+    void expireSubmits(bool all);
+};
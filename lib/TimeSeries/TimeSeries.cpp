@@ -0,0 +1,140 @@
+// ============================================================================
+// TimeSeries.cpp - fixed-memory metric history in PSRAM
+// ============================================================================
+#include "TimeSeries.h"
+#include <math.h>
+
+bool TimeSeries::begin() {
+    if (ready) return true;
+    if (!psramFound()) {
+        Serial.println("TimeSeries: no PSRAM, history disabled");
+        return false;
+    }
+
+    for (uint8_t t = 0; t < TS_TIERS; t++) {
+        tiers[t].points = (TsPoint*)ps_malloc(TS_CAPACITY[t] * TS_SERIES * sizeof(TsPoint));
+        tiers[t].times = (uint32_t*)ps_malloc(TS_CAPACITY[t] * sizeof(uint32_t));
+        if (!tiers[t].points || !tiers[t].times) {
+            Serial.println("TimeSeries: PSRAM allocation failed, history disabled");
+            for (uint8_t i = 0; i <= t; i++) {
+                free(tiers[i].points);
+                free(tiers[i].times);
+                tiers[i].points = nullptr;
+                tiers[i].times = nullptr;
+            }
+            return false;
+        }
+    }
+    ready = true;
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// WRITER
+// ----------------------------------------------------------------------------
+void TimeSeries::record(unsigned long now_ms, const MinerStats* miners) {
+    if (!ready) return;
+    uint32_t now_s = now_ms / 1000;
+    if (tiers[TIER_SECONDS].written.load(std::memory_order_relaxed) && now_s == last_s) return;
+    last_s = now_s;
+
+    TsPoint row[TS_SERIES];
+    for (size_t s = 0; s < TS_SERIES; s++) {
+        const MinerStats& m = miners[s];
+        row[s].hashrate = m.online ? m.hashrate : 0;
+        row[s].shares = (uint32_t)m.shares;
+        row[s].temp_deci = (int16_t)lroundf(m.temp * 10);
+        row[s].online_pct = m.online ? 100 : 0;
+        row[s].reserved = 0;
+    }
+    push(TIER_SECONDS, row, now_s);
+}
+
+// The row goes into its slot before the count that publishes it, so a
+// reader never sees an index whose slot is still being filled
+void TimeSeries::push(uint8_t tier, const TsPoint* row, uint32_t time_s) {
+    Tier& t = tiers[tier];
+    uint32_t index = t.written.load(std::memory_order_relaxed);
+    size_t slot = index % TS_CAPACITY[tier];
+    memcpy(t.points + slot * TS_SERIES, row, TS_SERIES * sizeof(TsPoint));
+    t.times[slot] = time_s;
+    t.written.store(index + 1, std::memory_order_release);
+
+    if (tier + 1 < TS_TIERS) accumulate(tier, row, time_s);
+}
+
+// Rows are bucketed by the next tier's step on the uptime clock. The first
+// row of a new bucket closes the previous one, so a stalled monitor leaves
+// a shorter average rather than a shifted one.
+void TimeSeries::accumulate(uint8_t tier, const TsPoint* row, uint32_t time_s) {
+    uint32_t step = TS_STEP_S[tier + 1];
+    uint32_t bucket = time_s ? (time_s - 1) / step : 0;  // a row ends its step
+    Accumulator* sums = acc[tier];
+
+    if (acc_rows[tier] && bucket != acc_bucket[tier]) {
+        uint32_t n = acc_rows[tier];
+        TsPoint mean[TS_SERIES];
+        for (size_t s = 0; s < TS_SERIES; s++) {
+            mean[s].hashrate = sums[s].hashrate / n;
+            mean[s].shares = sums[s].shares;
+            mean[s].temp_deci = (int16_t)lroundf(sums[s].temp / n);
+            mean[s].online_pct = (uint8_t)((sums[s].online + n / 2) / n);
+            mean[s].reserved = 0;
+        }
+        acc_rows[tier] = 0;
+        push(tier + 1, mean, (acc_bucket[tier] + 1) * step);
+    }
+
+    if (!acc_rows[tier]) memset(sums, 0, sizeof(acc[tier]));
+    acc_bucket[tier] = bucket;
+    for (size_t s = 0; s < TS_SERIES; s++) {
+        sums[s].hashrate += row[s].hashrate;
+        sums[s].temp += row[s].temp_deci;
+        sums[s].shares = row[s].shares;  // cumulative: the last one wins
+        sums[s].online += row[s].online_pct;
+    }
+    acc_rows[tier]++;
+}
+
+// ----------------------------------------------------------------------------
+// READERS
+// The slot after the newest row is the one the writer fills next, so only
+// capacity - 1 rows are offered. After copying, the count is read again:
+// any row it has since lapped may have been overwritten and is dropped.
+// ----------------------------------------------------------------------------
+uint32_t TimeSeries::end(TsTier tier) const {
+    return tiers[tier].written.load(std::memory_order_acquire);
+}
+
+size_t TimeSeries::read(TsTier tier, uint8_t series, uint32_t from,
+                        TsSample* out, size_t max, uint32_t* first) const {
+    if (!ready || series >= TS_SERIES || tier >= TS_TIERS) return 0;
+    const Tier& t = tiers[tier];
+    const uint32_t keep = TS_CAPACITY[tier] - 1;
+
+    uint32_t end = t.written.load(std::memory_order_acquire);
+    uint32_t oldest = (end > keep) ? end - keep : 0;
+    if (from < oldest) from = oldest;
+    if (from >= end) return 0;
+
+    size_t n = end - from;
+    if (n > max) n = max;
+    for (size_t i = 0; i < n; i++) {
+        size_t slot = (from + i) % TS_CAPACITY[tier];
+        out[i].time_s = t.times[slot];
+        out[i].point = t.points[slot * TS_SERIES + series];
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    end = t.written.load(std::memory_order_relaxed);
+    uint32_t intact = (end > keep) ? end - keep : 0;
+    if (intact > from) {
+        size_t drop = (intact - from < n) ? intact - from : n;
+        memmove(out, out + drop, (n - drop) * sizeof(TsSample));
+        n -= drop;
+        from += drop;
+    }
+
+    if (first) *first = from;
+    return n;
+}
@@ -0,0 +1,83 @@
+// ============================================================================
+// TimeSeries.h - fixed-memory metric history in PSRAM
+// Three ring tiers: one row per second for 10 minutes, per minute for 24
+// hours and per hour for 30 days. A row holds hashrate, temperature, shares
+// and online state for every miners[] slot, Core2 included. Each tier is
+// averaged into the next as its rows arrive, so nothing is ever rescanned.
+// One writer (the monitor task); the UI and web layers read without locks.
+// ============================================================================
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "MiningCore.h"
+
+static const size_t TS_SERIES = MAX_MINERS + 1;  // indexed like miners[]
+
+enum TsTier : uint8_t {
+    TIER_SECONDS,
+    TIER_MINUTES,
+    TIER_HOURS,
+    TS_TIERS
+};
+
+static const uint32_t TS_STEP_S[TS_TIERS] = { 1, 60, 3600 };
+static const size_t TS_CAPACITY[TS_TIERS] = { 600, 1440, 720 };
+
+// One miner over one step, 12 bytes
+struct TsPoint {
+    float hashrate;             // kH/s, mean over the step
+    uint32_t shares;            // cumulative, at the end of the step
+    int16_t temp_deci;          // 0.1 C, mean over the step
+    uint8_t online_pct;         // share of the step it was online
+    uint8_t reserved;
+};
+
+struct TsSample {
+    uint32_t time_s;            // seconds since boot at the end of the step
+    TsPoint point;
+};
+
+class TimeSeries {
+public:
+    // Allocates every tier up front (~300 KB); false without PSRAM, and
+    // record()/read() then do nothing
+    bool begin();
+
+    // Monitor task only. Takes at most one row per second of uptime.
+    void record(unsigned long now_ms, const MinerStats* miners);
+
+    // Any task, lock-free. Rows carry absolute indices: [oldest, end) are
+    // readable, where oldest = end - (capacity - 1) once the ring is full.
+    uint32_t end(TsTier tier) const;
+
+    // Copies one series' rows from absolute index `from` (moved up to the
+    // oldest row still intact) into out; *first gets out[0]'s index. Rows
+    // the writer reused during the copy are dropped, never returned torn.
+    size_t read(TsTier tier, uint8_t series, uint32_t from,
+                TsSample* out, size_t max, uint32_t* first) const;
+
+private:
+    struct Tier {
+        TsPoint* points = nullptr;              // capacity rows x TS_SERIES
+        uint32_t* times = nullptr;              // capacity rows
+        std::atomic<uint32_t> written{0};       // rows ever written
+    };
+
+    // Running sums of a tier's rows for the current step of the next tier
+    struct Accumulator {
+        float hashrate;
+        float temp;
+        uint32_t shares;
+        uint32_t online;
+    };
+
+    Tier tiers[TS_TIERS];
+    Accumulator acc[TS_TIERS - 1][TS_SERIES];
+    uint32_t acc_rows[TS_TIERS - 1] = {};
+    uint32_t acc_bucket[TS_TIERS - 1] = {};
+    uint32_t last_s = 0;
+    bool ready = false;
+
+    void push(uint8_t tier, const TsPoint* row, uint32_t time_s);
+    void accumulate(uint8_t tier, const TsPoint* row, uint32_t time_s);
+};
@@ -9,7 +9,7 @@ void runUDPListener(void *name, volatile bool &displayDirty, MinerStats (&miners
     Serial.println("UDP Listener started on port 8888");
     udp.begin(8888);
     
-    char buffer[64];
+    char buffer[96];
     unsigned long lastOfflineCheck = 0;
     
     while(1) {
@@ -20,13 +20,22 @@ void runUDPListener(void *name, volatile bool &displayDirty, MinerStats (&miners
             
             int id, shares_val, valids_val;
             float hashrate, temp;
+            double best_diff;
+            float effective;
             
-            if (sscanf(buffer, "%d,%f,%d,%d,%f", &id, &hashrate, &shares_val, &valids_val, &temp) == 5) {
+            // id,hashrate,shares,valids,temp[,best difficulty,effective kH/s]
+            int fields = sscanf(buffer, "%d,%f,%d,%d,%f,%lf,%f", &id, &hashrate, &shares_val, &valids_val, &temp, &best_diff, &effective);
+            if (fields >= 5) {
                 if (id >= 1 && id <= 5) {
                     miners[id - 1].hashrate = hashrate;
                     miners[id - 1].shares = shares_val;
                     miners[id - 1].valids = valids_val;
                     miners[id - 1].temp = temp;
+                    // Older firmware sends five fields: keep what a newer one sent
+                    if (fields == 7) {
+                        miners[id - 1].bestDifficulty = best_diff;
+                        miners[id - 1].effectiveHashrate = effective;
+                    }
                     miners[id - 1].lastUpdate = millis();
                     miners[id - 1].online = true;
                     displayDirty = true; // Mark display for update
@@ -0,0 +1,192 @@
+// ============================================================================
+// WorkQueue.cpp - work units prepared ahead of the hashing threads
+// ============================================================================
+#include "WorkQueue.h"
+#include "configs.h"
+
+WorkQueue::WorkQueue(JobSource& session, uint8_t workers)
+    : session(session) {
+    worker_count = constrain(workers, (uint8_t)1, (uint8_t)MAX_LOCAL_WORKERS);
+}
+
+void WorkQueue::begin() {
+    xTaskCreatePinnedToCore(
+        [](void* param) { ((WorkQueue*)param)->run(); },
+        "Work", WORK_STACK_SIZE, this, WORK_PRIORITY, &task, 0);
+}
+
+// ----------------------------------------------------------------------------
+// WORKER SIDE
+// Single producer, single consumer per lane: slots [head, tail) belong to
+// the worker, the rest to the producer.
+// ----------------------------------------------------------------------------
+const WorkUnit* WorkQueue::current(uint8_t worker) {
+    Lane& lane = lanes[worker % worker_count];
+    uint32_t head = lane.head.load(std::memory_order_relaxed);
+    if (head == lane.tail.load(std::memory_order_acquire)) return nullptr;
+    return &lane.ring[head % WORK_RING_SIZE];
+}
+
+void WorkQueue::release(uint8_t worker) {
+    Lane& lane = lanes[worker % worker_count];
+    lane.head.fetch_add(1, std::memory_order_release);
+    if (task) xTaskNotifyGive(task);  // refill now, not on the next poll
+}
+
+// ----------------------------------------------------------------------------
+// PRODUCER TASK
+// ----------------------------------------------------------------------------
+void WorkQueue::run() {
+    while (true) {
+        for (uint8_t w = 0; w < worker_count; w++) fill(w);
+        // Woken early by release()
+        ulTaskNotifyTake(pdTRUE, WORK_POLL_MS / portTICK_PERIOD_MS);
+    }
+}
+
+// Top the lane's ring up. A newer job replaces the lane's own from the next
+// unit on; the worker skips units already queued for an older one. A lane
+// that has rolled through all its work waits here for the next job.
+void WorkQueue::fill(uint8_t worker) {
+    Lane& lane = lanes[worker];
+    if (!lane.has_job || lane.job.generation != session.generation()) {
+        if (!takeJob(worker)) return;
+    }
+    if (lane.exhausted) return;
+
+    uint32_t tail = lane.tail.load(std::memory_order_relaxed);
+    while (tail - lane.head.load(std::memory_order_acquire) < WORK_RING_SIZE) {
+        WorkUnit& unit = lane.ring[tail % WORK_RING_SIZE];
+        unit.generation = lane.job.generation;
+        unit.job = lane.precompute;
+        unit.share_target = lane.share_target;
+        unit.share_difficulty = lane.share_difficulty;
+        memcpy(unit.target, lane.job.target, sizeof(unit.target));
+        unit.version_bits = lane.version_bits;
+        unit.ntime = (lane.ntime != lane.job.ntime) ? lane.ntime : 0;
+        unit.extranonce2 = lane.extranonce2_value;
+        lane.tail.store(++tail, std::memory_order_release);
+
+        if (!rollWork(worker)) {
+            if (!lane.exhausted) lane.has_job = false;
+            return;
+        }
+    }
+}
+
+// Copy the session's current job and build the lane's first header for it
+bool WorkQueue::takeJob(uint8_t worker) {
+    Lane& lane = lanes[worker];
+    lane.has_job = false;
+    if (!session.copyJob(&lane.job, worker)) return false;
+
+    lane.exhausted = false;
+    lane.extranonce2_counter = 0;
+    lane.version_bits = 0;
+    lane.ntime = lane.job.ntime;
+    setExtranonce2(worker);
+
+    // Header: version | prevhash | merkle root | ntime | nbits | nonce, all
+    // little-endian; the session already put prevhash in header order
+    uint8_t* header = lane.header;
+    if (lane.job.header_only) {
+        memcpy(header + 36, lane.job.merkle_root, 32);
+    } else if (!session.merkleRoot(lane.job.generation, lane.extranonce2, header + 36)) {
+        return false;
+    }
+    // The first unit mines version_bits 0 like every rolled unit does, so
+    // the pool rebuilds the same version from the bits it is sent
+    uint32_t version = lane.job.version & ~lane.job.version_mask;
+    memcpy(header, &version, 4);
+    memcpy(header + 4, lane.job.prevhash, 32);
+    memcpy(header + 68, &lane.ntime, 4);
+    memcpy(header + 72, &lane.job.nbits, 4);
+    memset(header + 76, 0, 4);
+
+    // Share target for the kernel: the pool's difficulty for this job
+    sha256_target_init(&lane.share_target, lane.job.share_target);
+    lane.share_difficulty = hashDifficulty(lane.job.share_target);
+
+    sha256_job_init(&lane.precompute, header);
+    lane.has_job = true;
+    if (!session.isStale(lane.job.generation)) session.workResumed();
+    return true;
+}
+
+// extranonce2 = extranonce2_size bytes, big-endian. The worker index sits
+// on top so threads sharing one session never mine the same coinbase: the
+// whole top byte when there are two bytes or more, only the bits the worker
+// count needs when there is one. The counter fills the bits below it.
+int WorkQueue::counterBits(size_t extranonce2_size) const {
+    if (extranonce2_size >= 2) return 8 * (int)((extranonce2_size < 8) ? extranonce2_size : 8) - 8;
+    if (extranonce2_size == 0) return 0;
+    int worker_bits = 0;
+    while ((1u << worker_bits) < worker_count) worker_bits++;
+    return 8 - worker_bits;
+}
+
+void WorkQueue::setExtranonce2(uint8_t worker) {
+    Lane& lane = lanes[worker];
+    size_t size = lane.job.extranonce2_size;
+    int bits = counterBits(size);
+    uint64_t low_mask = (1ULL << bits) - 1;
+    uint64_t value = ((uint64_t)worker << bits) | (lane.extranonce2_counter & low_mask);
+
+    lane.extranonce2_value = value;
+    for (size_t i = 0; i < size; i++) {
+        size_t shift = size - 1 - i;
+        lane.extranonce2[i] = (shift < 8) ? (uint8_t)(value >> (8 * shift)) : 0;
+    }
+}
+
+// Next unit's work for the lane's job. With version rolling that is just
+// the next set of version bits and a new midstate; extranonce2 only moves
+// once every allowed version has been tried. False once the session has
+// moved on to another job, or the lane has no extranonce2 or ntime left.
+bool WorkQueue::rollWork(uint8_t worker) {
+    Lane& lane = lanes[worker];
+    uint32_t version_mask = lane.job.version_mask;
+    if (version_mask) {
+        lane.version_bits = ((lane.version_bits | ~version_mask) + 1) & version_mask;
+        uint32_t version = (lane.job.version & ~version_mask) | lane.version_bits;
+        memcpy(lane.header, &version, 4);  // header is little-endian
+        if (lane.version_bits != 0) {
+            sha256_job_init(&lane.precompute, lane.header);
+            return true;
+        }
+    }
+    return rollExtranonce2(worker);
+}
+
+// Fresh work for the current job without asking the pool: next extranonce2,
+// then only the coinbase tail, the merkle path and the midstate are redone.
+bool WorkQueue::rollExtranonce2(uint8_t worker) {
+    Lane& lane = lanes[worker];
+    if (lane.job.header_only) return rollNtime(lane);
+    // Wrapping would repeat work already done (and shares already sent)
+    if ((lane.extranonce2_counter + 1) >> counterBits(lane.job.extranonce2_size)) {
+        lane.exhausted = true;
+        return false;
+    }
+    lane.extranonce2_counter++;
+    setExtranonce2(worker);
+
+    if (!session.merkleRoot(lane.job.generation, lane.extranonce2, lane.header + 36)) return false;
+    sha256_job_init(&lane.precompute, lane.header);
+    return true;
+}
+
+// Header-only (Stratum V2 standard) jobs have no extranonce: the pool lets
+// ntime move forward instead. One second buys another nonce x version space.
+// Pools reject ntime too far ahead, so past MAX_NTIME_ROLL_S the lane waits
+// for the next job.
+bool WorkQueue::rollNtime(Lane& lane) {
+    if (lane.ntime - lane.job.ntime >= MAX_NTIME_ROLL_S) {
+        lane.exhausted = true;
+        return false;
+    }
+    lane.ntime++;
+    memcpy(lane.header + 68, &lane.ntime, 4);
+    sha256_job_init(&lane.precompute, lane.header);
+    return true;
+}
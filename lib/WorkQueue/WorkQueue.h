@@ -0,0 +1,76 @@
+// ============================================================================
+// WorkQueue.h - work units prepared ahead of the hashing threads
+// A producer task turns session jobs into ready-to-scan units: header,
+// midstate, share target and extranonce2 all done. Each worker has its own
+// two-slot ring, the unit it is mining and the next one, so moving on to
+// new work is a pointer swap and hashing threads never touch a coinbase.
+// ============================================================================
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include "sha256.h"
+#include "Stratum.h"
+#include "configs.h"
+
+static const size_t WORK_RING_SIZE = 2;     // being mined + prepared next
+static const uint32_t WORK_POLL_MS = 5;     // producer looks for new jobs this often
+
+// One nonce range ready to scan: all 2^32 nonces over a fixed header
+struct WorkUnit {
+    uint32_t generation;        // session job it was built from
+    JobPrecompute job;          // midstate + header tail for the kernel
+    ShareTarget share_target;
+    double share_difficulty;    // pool difficulty of share_target, for effective hashrate
+    uint8_t target[32] __attribute__((aligned(4)));  // network target, for block checks
+
+    // What a share from this unit is submitted with
+    uint32_t version_bits;
+    uint32_t ntime;             // 0 = the job's own ntime
+    uint64_t extranonce2;
+};
+
+class WorkQueue {
+public:
+    WorkQueue(JobSource& session, uint8_t workers);
+    void begin();               // starts the producer task
+
+    // Worker side, lock-free. current() is the unit to mine, nullptr until
+    // one is ready; release() hands it back once exhausted or stale.
+    const WorkUnit* current(uint8_t worker);
+    void release(uint8_t worker);
+
+private:
+    struct Lane {
+        WorkUnit ring[WORK_RING_SIZE];
+        std::atomic<uint32_t> head{0};  // worker: unit being mined
+        std::atomic<uint32_t> tail{0};  // producer: next slot to fill
+
+        // Producer only: the lane's job and how far it has been rolled
+        StratumJob job;
+        bool has_job = false;
+        bool exhausted = false;         // extranonce2 or ntime range spent for this job
+        uint64_t extranonce2_counter = 0;
+        uint8_t extranonce2[MAX_EXTRANONCE2];
+        uint64_t extranonce2_value = 0;
+        uint32_t version_bits = 0;
+        uint32_t ntime = 0;
+        uint8_t header[80] __attribute__((aligned(4)));
+        JobPrecompute precompute;
+        ShareTarget share_target;
+        double share_difficulty = 0;
+    };
+
+    JobSource& session;
+    Lane lanes[MAX_LOCAL_WORKERS];
+    uint8_t worker_count;
+    TaskHandle_t task = nullptr;
+
+    void run();
+    void fill(uint8_t worker);
+    bool takeJob(uint8_t worker);
+    int counterBits(size_t extranonce2_size) const;
+    void setExtranonce2(uint8_t worker);
+    bool rollWork(uint8_t worker);
+    bool rollExtranonce2(uint8_t worker);
+    bool rollNtime(Lane& lane);
+};
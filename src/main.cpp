@@ -8,6 +8,13 @@
 #include <WebServer.h>
 #include "Server.h"
 #include "configs.h"
+#include "Stratum.h"
+#include "StratumProxy.h"
+#include "StratumV2.h"
+#include "WorkQueue.h"
+#include "HashrateMeter.h"
+#include "TimeSeries.h"
+#include "StatsStore.h"
 #include "BitcoinMiner.h"
 #include "UiManagement.h"
 #include "UdpListiner.h"
@@ -48,6 +55,10 @@ MinerUICache minerUI[MAX_MINERS + 1]; // +1 for Core2
 
 
 WebServer server(80);
+StratumProxy* proxy = nullptr;   // set in setup() when ENABLE_PROXY
+HashrateMeter hashrateMeter;     // sampled by runMonitor, read by /data
+TimeSeries timeSeries;           // recorded by runMonitor, read by /history
+StatsStore statsStore;           // lifetime totals, updated by runMonitor
 Preferences prefs;
 unsigned long startTime = 0;
 
@@ -211,36 +222,180 @@ void handleRoot() {
     server.send(200, "text/html", outBuf);
 }
 
-// Safe JSON for /data using fixed buffer
+// ----------------------------------------------------------------------------
+// /data JSON
+// One static buffer sized for the worst case: each piece's format string
+// (longer than the literal text it prints) plus every field at its widest.
+// A float as %.Nf can take 44 chars, a share difficulty (up to 2^224) 72.
+// ----------------------------------------------------------------------------
+static const size_t JSON_FLOAT = 44, JSON_DIFF = 72, JSON_U32 = 10, JSON_U64 = 20;
+static const size_t JSON_IP = 15;      // 255.255.255.255
+
+static const char DATA_HEAD[] =
+    "{\"hr\":%.2f,\"hr_10s\":%.2f,\"hr_5m\":%.2f,\"hr_15m\":%.2f,\"shares\":%u,\"valids\":%u,\"templates\":%u,\"stale_ms\":%lu,"
+    "\"uptime\":%lu,\"temp\":%.1f,\"pool\":\"%.63s:%u\",\"ip\":\"%s\","
+    "\"submitted\":%u,\"accepted\":%u,\"rejected\":%u,\"stale\":%u,\"duplicate\":%u,"
+    "\"low_diff\":%u,\"timed_out\":%u,\"best_diff\":%.1f,\"eff_hr\":%.2f,\"eff_ratio\":%.3f,"
+    "\"rtt_ms\":%u,\"rtt_hist\":[";
+static const char DATA_LIFETIME[] =
+    "],\"lifetime\":{\"hashes\":%llu,\"shares\":%llu,\"valids\":%llu,\"templates\":%llu,"
+    "\"uptime_s\":%llu,\"boots\":%u,\"miners\":[";
+static const char DATA_LIFETIME_MINER[] = "%s[%llu,%llu]";
+static const char DATA_PROXY[] = "%s{\"worker\":\"%.47s\",\"ip\":\"%s\",\"up\":%s,\"sub\":%u,\"acc\":%u,\"rej\":%u}";
+
+static const size_t DATA_JSON_MAX =
+    sizeof(DATA_HEAD) + 7 * JSON_FLOAT + JSON_DIFF + 14 * JSON_U32 + 63 + JSON_IP +
+    SUBMIT_RTT_BUCKETS * (1 + JSON_U32) +
+    sizeof("],\"diff_hist\":[") + DIFF_BUCKETS * (1 + JSON_U32) +
+    sizeof(DATA_LIFETIME) + 5 * JSON_U64 + JSON_U32 +
+    (MAX_MINERS + 1) * (sizeof(DATA_LIFETIME_MINER) + 2 * JSON_U64) +
+    sizeof("]},\"threads_hr\":[") + MAX_LOCAL_WORKERS * (1 + JSON_FLOAT) +
+    sizeof("],\"proxy\":[") + MAX_DOWNSTREAM * (sizeof(DATA_PROXY) + 47 + JSON_IP + 5 + 3 * JSON_U32) +
+    sizeof("]}");
+
+// snprintf onto the end of buf that never moves len past it: a piece that
+// does not fit leaves the buffer full and every later append does nothing
+static bool jsonAppend(char* buf, size_t cap, size_t& len, const char* fmt, ...) {
+    if (len + 1 >= cap) return false;
+    va_list args;
+    va_start(args, fmt);
+    int w = vsnprintf(buf + len, cap - len, fmt, args);
+    va_end(args);
+    if (w < 0) w = 0;
+    bool fits = (size_t)w < cap - len;
+    len = fits ? len + w : cap - 1;
+    return fits;
+}
+
 void handleData() {
+    // Hashing counters are lock-free; only the submit stats need the mutex
+    unsigned long now = millis();
+    WorkerCounters counters = statsSnapshot();
+    float hashrate = hashrateMeter.rate(RATE_1M) / 1000.0f;      // kH/s
+    float hashrate10s = hashrateMeter.rate(RATE_10S) / 1000.0f;
+    float hashrate5m = hashrateMeter.rate(RATE_5M) / 1000.0f;
+    float hashrate15m = hashrateMeter.rate(RATE_15M) / 1000.0f;
+    unsigned long uptimeMin = (now - startTime) / 60000UL;
+    unsigned int u_shares = (unsigned int)counters.shares;
+    unsigned int u_valids = (unsigned int)counters.valids;
+    unsigned int u_templates = templates.load(std::memory_order_relaxed);
+    unsigned long u_stale = staleWorkMs.load(std::memory_order_relaxed);
+    float temp = temperatureRead();
+
+    // Share difficulty: lifetime best and effective rate, and this boot's
+    // share-implied hashes over the counted ones (~1.0 unless the kernel
+    // misses or invents shares; noisy until there are a few hundred)
+    LifetimeStats lifetime = statsStore.snapshot();
+    float effectiveHashrate = lifetime.uptime_s ? lifetime.effective_hashes / lifetime.uptime_s / 1000.0 : 0;
+    float effectiveRatio = counters.hashes ? (counters.share_difficulty * DIFF1_HASHES) / counters.hashes : 0.0f;
+
     // try to take mutex but protect against deadlock — short wait
     if (xSemaphoreTake(statsMutex, 50 / portTICK_PERIOD_MS) == pdFALSE) {
         server.send(503, "application/json", "{\"error\":\"busy\"}");
         return;
     }
-
-    // copy needed fields quickly
-    unsigned long now = millis();
-    float hashrate = (now > startTime) ? ((hashes / ((now - startTime) / 1000.0f)) / 1000.0f) : 0.0f;
-    unsigned long uptimeMin = (now - startTime) / 60000UL;
-    unsigned int u_shares = shares;
-    unsigned int u_valids = valids;
-    unsigned int u_templates = templates;
-    float temp = temperatureRead();
+    SubmitStats submits = submitStats;
     xSemaphoreGive(statsMutex);
 
+    // Per-miner stats for the S3s mining through the proxy
+    static ProxyMinerStats downstream[MAX_DOWNSTREAM];
+    size_t downstreamCount = proxy ? proxy->stats(downstream, MAX_DOWNSTREAM) : 0;
+
     // build JSON into fixed buffer
-    char jsonBuf[512];
-    snprintf(jsonBuf, sizeof(jsonBuf),
-             "{\"hr\":%.2f,\"shares\":%u,\"valids\":%u,\"templates\":%u,"
-             "\"uptime\":%lu,\"temp\":%.1f,\"pool\":\"%s:%u\",\"ip\":\"%s\"}",
-             hashrate, u_shares, u_valids, u_templates,
+    static char jsonBuf[DATA_JSON_MAX];
+    const size_t cap = sizeof(jsonBuf);
+    size_t len = 0;
+    bool ok = jsonAppend(jsonBuf, cap, len, DATA_HEAD,
+             hashrate, hashrate10s, hashrate5m, hashrate15m, u_shares, u_valids, u_templates, u_stale,
              uptimeMin, temp,
-             POOL_URL, (unsigned)POOL_PORT, WiFi.localIP().toString().c_str());
+             POOL_URL, (unsigned)POOL_PORT, WiFi.localIP().toString().c_str(),
+             (unsigned)submits.sent, (unsigned)submits.accepted, (unsigned)submits.rejected,
+             (unsigned)submits.stale, (unsigned)submits.duplicate, (unsigned)submits.low_difficulty,
+             (unsigned)submits.timed_out, lifetime.best_difficulty, effectiveHashrate, effectiveRatio,
+             (unsigned)submits.last_rtt_ms);
+    for (int i = 0; i < SUBMIT_RTT_BUCKETS; i++) {
+        ok &= jsonAppend(jsonBuf, cap, len, i ? ",%u" : "%u", (unsigned)submits.rtt_histogram[i]);
+    }
+    // Lifetime shares by difficulty hit, log2 buckets: <2, <4 ... >= 2^39
+    ok &= jsonAppend(jsonBuf, cap, len, "],\"diff_hist\":[");
+    for (int i = 0; i < DIFF_BUCKETS; i++) {
+        ok &= jsonAppend(jsonBuf, cap, len, i ? ",%u" : "%u", (unsigned)lifetime.difficulty_histogram[i]);
+    }
+    // Totals over every boot; miners as [shares, valids] like miners[]
+    ok &= jsonAppend(jsonBuf, cap, len, DATA_LIFETIME,
+             (unsigned long long)lifetime.hashes, (unsigned long long)lifetime.shares,
+             (unsigned long long)lifetime.valids, (unsigned long long)lifetime.templates,
+             (unsigned long long)lifetime.uptime_s, (unsigned)lifetime.boots);
+    for (int i = 0; i <= MAX_MINERS; i++) {
+        ok &= jsonAppend(jsonBuf, cap, len, DATA_LIFETIME_MINER, i ? "," : "",
+                         (unsigned long long)lifetime.miners[i].shares, (unsigned long long)lifetime.miners[i].valids);
+    }
+    // Per-thread 10 s rates: a slow or throttled thread shows up here first
+    ok &= jsonAppend(jsonBuf, cap, len, "]},\"threads_hr\":[");
+    for (int i = 0; i < THREADS && i < MAX_LOCAL_WORKERS; i++) {
+        ok &= jsonAppend(jsonBuf, cap, len, i ? ",%.2f" : "%.2f",
+                         hashrateMeter.workerRate(i, RATE_10S) / 1000.0f);
+    }
+    ok &= jsonAppend(jsonBuf, cap, len, "],\"proxy\":[");
+    for (size_t i = 0; i < downstreamCount; i++) {
+        const ProxyMinerStats& d = downstream[i];
+        ok &= jsonAppend(jsonBuf, cap, len, DATA_PROXY,
+                 i ? "," : "", d.worker, IPAddress(d.ip).toString().c_str(), d.connected ? "true" : "false",
+                 (unsigned)d.submitted, (unsigned)d.accepted, (unsigned)d.rejected);
+    }
+    ok &= jsonAppend(jsonBuf, cap, len, "]}");
 
+    // Cut short would be invalid JSON; the budget above makes this unreachable
+    if (!ok) {
+        server.send(500, "application/json", "{\"error\":\"overflow\"}");
+        return;
+    }
     server.send(200, "application/json", jsonBuf);
 }
 
+// Metric history for one miners[] slot: /history?miner=5&tier=m
+// tier s = per second (10 min), m = per minute (24 h), h = per hour (30 d).
+// Streamed in chunks straight from the ring, oldest row first.
+void handleHistory() {
+    int series = server.hasArg("miner") ? server.arg("miner").toInt() : 5;  // Core2
+    String tierArg = server.hasArg("tier") ? server.arg("tier") : "m";
+    TsTier tier = (tierArg == "s") ? TIER_SECONDS : (tierArg == "h") ? TIER_HOURS : TIER_MINUTES;
+    if (series < 0 || series >= (int)TS_SERIES) {
+        server.send(400, "application/json", "{\"error\":\"miner\"}");
+        return;
+    }
+
+    // A row at its widest: time, two floats, shares, percent
+    static const char ROW[] = "%s[%u,%.2f,%.1f,%u,%u]";
+    static const size_t ROWS = 16;
+    static char chunk[ROWS * (sizeof(ROW) + 2 * JSON_FLOAT + 3 * JSON_U32)];
+    static TsSample rows[ROWS];
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
+    snprintf(chunk, sizeof(chunk), "{\"miner\":%d,\"step_s\":%u,\"now_s\":%lu,\"rows\":[",
+             series, (unsigned)TS_STEP_S[tier], millis() / 1000UL);
+    server.sendContent(chunk);
+
+    // [time_s, kH/s, temp C, shares, online %]
+    uint32_t from = 0;
+    bool firstRow = true;
+    size_t got;
+    while ((got = timeSeries.read(tier, series, from, rows, ROWS, &from)) > 0) {
+        size_t len = 0;
+        for (size_t i = 0; i < got; i++) {
+            const TsPoint& p = rows[i].point;
+            jsonAppend(chunk, sizeof(chunk), len, ROW,
+                       firstRow ? "" : ",", (unsigned)rows[i].time_s, p.hashrate,
+                       p.temp_deci / 10.0f, (unsigned)p.shares, (unsigned)p.online_pct);
+            firstRow = false;
+        }
+        server.sendContent(chunk, len);
+        from += got;
+    }
+    server.sendContent("]}");
+    server.sendContent("");  // ends the chunked response
+}
+
 void handleSave() {
     // read form args (these are small transient Strings provided by server.arg)
     if (server.hasArg("pool")) POOL_URL = server.arg("pool").c_str();
@@ -248,6 +403,7 @@ void handleSave() {
     if (server.hasArg("addr")) ADDRESS = server.arg("addr").c_str();
 
     saveConfig();
+    statsStore.flush();  // the restart must not cost the last checkpoint interval
 
     // minimal HTML response — no large allocations
     server.send(200, "text/html",
@@ -259,6 +415,7 @@ void handleSave() {
 void handleReboot() {
     server.send(200, "text/html",
                 "<h1 style='color:#f00;background:#000;text-align:center;padding:100px'>Rebooting...</h1>");
+    statsStore.flush();
     delay(1000);
     ESP.restart();
 }
@@ -266,6 +423,7 @@ void handleReboot() {
 void setupWebServer() {
     server.on("/", handleRoot);
     server.on("/data", handleData);
+    server.on("/history", handleHistory);
     server.on("/save", HTTP_POST, handleSave);
     server.on("/reboot", HTTP_POST, handleReboot);
 
@@ -800,6 +958,44 @@ void runMonitor(void *name) {
     
     while (1) {
         unsigned long now = millis();
+
+        // Rate windows and history need steady samples, not just one per
+        // screen refresh, so the Core2's own entry is kept current here
+        hashrateMeter.sample(now);
+
+        // Lock-free: sums every miner thread's slot. Counters are 64-bit,
+        // monotonic and never reset; rates come from the hashrate meter.
+        WorkerCounters counters = statsSnapshot();
+        
+        uint64_t local_hashes = counters.hashes;
+        long local_templates = templates.load(std::memory_order_relaxed);
+        int local_halfshares = (int)counters.halfshares;
+        int local_shares = (int)counters.shares;
+        int local_valids = (int)counters.valids;
+        bool local_blockFound = blockFound.load(std::memory_order_acquire);
+        unsigned long local_blockTime = blockFoundTime.load(std::memory_order_relaxed);
+        
+        // Cache temperature reading (expensive operation)
+        if (now - lastTempRead > 5000) {
+            cachedTemp = temperatureRead();
+            lastTempRead = now;
+        }
+        
+        float core2_hashrate = hashrateMeter.rate(RATE_1M) / 1000.0f;
+        
+        miners[5].hashrate = core2_hashrate;
+        miners[5].shares = local_shares;
+        miners[5].valids = local_valids;
+        miners[5].temp = cachedTemp;
+        miners[5].online = true;
+
+        // Lifetime totals; checkpoints to flash when due
+        statsStore.update(now, counters, miners, 5);
+        LifetimeStats lifetime = statsStore.snapshot();
+        miners[5].bestDifficulty = lifetime.best_difficulty;
+        miners[5].effectiveHashrate = lifetime.uptime_s ? lifetime.effective_hashes / lifetime.uptime_s / 1000.0 : 0;
+
+        timeSeries.record(now, miners);
         
         M5.update();
         if (M5.BtnA.wasPressed()) {
@@ -822,96 +1018,6 @@ void runMonitor(void *name) {
         vTaskDelay(10 / portTICK_PERIOD_MS);
         
         unsigned long elapsed = now - start;
-    
-        xSemaphoreTake(statsMutex, portMAX_DELAY);
-        if (hashes == 65536000) {
-            // Prevent overflow
-            start = now;
-            hashes = 0;
-        }
-        if (templates == 65536000) {
-            // Prevent overflow
-            start = now;
-            templates = 0;
-        }
-        if (shares == 65536000) {
-            // Prevent overflow
-            start = now;
-            shares = 0;
-        }
-        if (valids == 65536000) {
-            // Prevent overflow
-            start = now;
-            valids = 0;
-        }
-        if (halfshares == 65536000) {
-            // Prevent overflow
-            start = now;
-            halfshares = 0;
-        }
-        if (blockFoundTime == 65536000) {
-            // Prevent overflow
-            start = now;
-            blockFoundTime = 0;
-        }
-        if (blockFound == 65536000) {
-            // Prevent overflow
-            start = now;
-            blockFound = 0;
-        }
-        if (now - start > 3600000) {
-            // Reset every hour to prevent overflows
-            start = now;
-            hashes = 0;
-            blockFoundTime = 0;
-            blockFound = 0;
-        }
-        for (int i = 0; i < sizeof(miners) / sizeof(miners[0]) -1; i++) {
-            if (miners[i].hashrate == 65536000) {
-                // Prevent overflow
-                miners[i].hashrate = 0;
-            }
-            if (miners[i].shares == 65536000) {
-                // Prevent overflow
-                miners[i].shares = 0;
-            }
-            if (miners[i].valids == 65536000) {
-                // Prevent overflow
-                miners[i].valids = 0;
-            }
-            if (miners[i].temp == 65536000) {
-                // Prevent overflow
-                miners[i].temp = 0;
-            }
-        }
-        
-        long local_hashes = hashes;
-        long local_templates = templates;
-        int local_halfshares = halfshares;
-        int local_shares = shares;
-        int local_valids = valids;
-        bool local_blockFound = blockFound;
-        unsigned long local_blockTime = blockFoundTime;
-        
-        
-        // Cache temperature reading (expensive operation)
-        if (now - lastTempRead > 5000) {
-            cachedTemp = temperatureRead();
-            lastTempRead = now;
-        }
-        
-        float core2_hashrate = 0;
-        if (elapsed > 0) {
-            core2_hashrate = (float)local_hashes / (elapsed / 1000.0f) / 1000.0f;
-        }
-        xSemaphoreGive(statsMutex);
-        
-        
-        miners[5].hashrate = core2_hashrate;
-        miners[5].shares = local_shares;
-        miners[5].valids = local_valids;
-        miners[5].temp = cachedTemp;
-        miners[5].online = true;
 
         // Calculate totals once
         float totalHashrate = 0;
@@ -1269,8 +1375,9 @@ void runMonitor(void *name) {
         drawIfChanged(fancyUI.totalHashes, hashesM, 1, 80, y, WHITE, "%.2fM");
         
         // us/hash
-        if (local_hashes > 0 && elapsed > 0) {
-            float usPerHash = (elapsed * 1000.0) / local_hashes;
+        float rate10s = hashrateMeter.rate(RATE_10S);
+        if (rate10s > 0) {
+            float usPerHash = 1000000.0f / rate10s;
             if (abs(fancyUI.usPerHash - usPerHash) > 0.1f) {
                 fancyUI.usPerHash = usPerHash;
                 M5.Lcd.fillRect(200, y, 50, 8, BLACK);
@@ -1358,6 +1465,8 @@ void setup(){
         miners[i].temp = 0;
         miners[i].lastUpdate = 0;
         miners[i].online = false;
+        miners[i].bestDifficulty = 0;
+        miners[i].effectiveHashrate = 0;
     }
 
     setCpuFrequencyMhz(240);
@@ -1423,6 +1532,8 @@ void setup(){
     M5.Lcd.println("Listening for S3 miners...");
 
     delay(2000);
+    timeSeries.begin();  // before any reader task starts
+    statsStore.begin();  // before runMonitor folds this boot in
     if (ENABLE_WEB_SERVER) {
         M5.Lcd.setTextColor(WHITE);
         M5.Lcd.setCursor(10, 210);
@@ -1466,44 +1577,73 @@ void setup(){
     
     delay(2000);
     
+    // One pool connection shared by every mining thread
+    JobSource* source;
+    if (USE_STRATUM_V2) {
+        static Sv2Session sv2Session(THREADS);
+        sv2Session.setPool(SV2_POOL_URL, SV2_POOL_PORT);
+        sv2Session.begin();
+        source = &sv2Session;
+    } else {
+        static StratumSession session;
+        session.addPool(POOL_URL, POOL_PORT);
+        for (const PoolConfig& pool : FALLBACK_POOLS) {
+            session.addPool(pool.host, pool.port);
+        }
+        if (ENABLE_PROXY) {
+            // Other miners on the LAN can mine through this session
+            static StratumProxy stratumProxy(session, PROXY_PORT);
+            session.setListener(&stratumProxy);
+            stratumProxy.begin();
+            proxy = &stratumProxy;
+        }
+        session.begin();
+        source = &session;
+    }
+    JobSource& session = *source;
+
+    // Headers and midstates are built ahead of the miners by one producer
+    static WorkQueue work(session, THREADS);
+    work.begin();
+
     // Mining tasks - highest priority for maximum hashrate
     if (CORES == 1) {
         if (THREADS == 1) {
-            static BitcoinMiner miner1("M1", 0);
-            xTaskCreatePinnedToCore([](void*){ miner1.start(); }, "M1", 35000, nullptr, THREAD_PRIORITY, nullptr, 1);
+            static BitcoinMiner miner1("M1", session, work, 0);
+            xTaskCreatePinnedToCore([](void*){ miner1.start(); }, "M1", MINER_STACK_SIZE, nullptr, THREAD_PRIORITY, nullptr, 1);
         }
         if (THREADS == 2) {
-            static BitcoinMiner miner1("M1", 0);
-            static BitcoinMiner miner2("M2", 0);
-            xTaskCreatePinnedToCore([](void*){ miner1.start(); }, "M1", 35000, nullptr, THREAD_PRIORITY, nullptr, 1);
-            xTaskCreatePinnedToCore([](void*){ miner2.start(); }, "M2", 35000, nullptr, THREAD_PRIORITY, nullptr, 1);
+            static BitcoinMiner miner1("M1", session, work, 0);
+            static BitcoinMiner miner2("M2", session, work, 1);
+            xTaskCreatePinnedToCore([](void*){ miner1.start(); }, "M1", MINER_STACK_SIZE, nullptr, THREAD_PRIORITY, nullptr, 1);
+            xTaskCreatePinnedToCore([](void*){ miner2.start(); }, "M2", MINER_STACK_SIZE, nullptr, THREAD_PRIORITY, nullptr, 1);
         }
         
     }else if (CORES == 2)
     {
         if (THREADS == 2) {
-        static BitcoinMiner miner1("M1", 0);
-        static BitcoinMiner miner2("M2", 1);
-        xTaskCreatePinnedToCore([](void*){ miner1.start(); }, "M1", 35000, nullptr, THREAD_PRIORITY, nullptr, 0);
-        xTaskCreatePinnedToCore([](void*){ miner2.start(); }, "M2", 35000, nullptr, THREAD_PRIORITY, nullptr, 1);
+        static BitcoinMiner miner1("M1", session, work, 0);
+        static BitcoinMiner miner2("M2", session, work, 1);
+        xTaskCreatePinnedToCore([](void*){ miner1.start(); }, "M1", MINER_STACK_SIZE, nullptr, THREAD_PRIORITY, nullptr, 0);
+        xTaskCreatePinnedToCore([](void*){ miner2.start(); }, "M2", MINER_STACK_SIZE, nullptr, THREAD_PRIORITY, nullptr, 1);
       }
       if (THREADS == 3){
-          static BitcoinMiner miner1("M1", 0);
-          static BitcoinMiner miner2("M2", 1);
-          static BitcoinMiner miner3("M3", 1);
-          xTaskCreatePinnedToCore([](void*){ miner1.start(); }, "M1", 35000, nullptr, THREAD_PRIORITY, nullptr, 0);
-          xTaskCreatePinnedToCore([](void*){ miner2.start(); }, "M2", 35000, nullptr, THREAD_PRIORITY, nullptr, 1);
-          xTaskCreatePinnedToCore([](void*){ miner3.start(); }, "M3", 35000, nullptr, THREAD_PRIORITY, nullptr, 1);
+          static BitcoinMiner miner1("M1", session, work, 0);
+          static BitcoinMiner miner2("M2", session, work, 1);
+          static BitcoinMiner miner3("M3", session, work, 2);
+          xTaskCreatePinnedToCore([](void*){ miner1.start(); }, "M1", MINER_STACK_SIZE, nullptr, THREAD_PRIORITY, nullptr, 0);
+          xTaskCreatePinnedToCore([](void*){ miner2.start(); }, "M2", MINER_STACK_SIZE, nullptr, THREAD_PRIORITY, nullptr, 1);
+          xTaskCreatePinnedToCore([](void*){ miner3.start(); }, "M3", MINER_STACK_SIZE, nullptr, THREAD_PRIORITY, nullptr, 1);
       }
       if (THREADS == 4) {
-          static BitcoinMiner miner1("M1", 0);
-          static BitcoinMiner miner2("M2", 1);
-          static BitcoinMiner miner3("M3", 0);
-          static BitcoinMiner miner4("M4", 1);
-          xTaskCreatePinnedToCore([](void*){ miner1.start(); }, "M1", 35000, nullptr, THREAD_PRIORITY, nullptr, 0);
-          xTaskCreatePinnedToCore([](void*){ miner2.start(); }, "M2", 35000, nullptr, THREAD_PRIORITY, nullptr, 1);
-          xTaskCreatePinnedToCore([](void*){ miner3.start(); }, "M3", 35000, nullptr, THREAD_PRIORITY, nullptr, 0);
-          xTaskCreatePinnedToCore([](void*){ miner4.start(); }, "M4", 35000, nullptr, THREAD_PRIORITY, nullptr, 1);
+          static BitcoinMiner miner1("M1", session, work, 0);
+          static BitcoinMiner miner2("M2", session, work, 1);
+          static BitcoinMiner miner3("M3", session, work, 2);
+          static BitcoinMiner miner4("M4", session, work, 3);
+          xTaskCreatePinnedToCore([](void*){ miner1.start(); }, "M1", MINER_STACK_SIZE, nullptr, THREAD_PRIORITY, nullptr, 0);
+          xTaskCreatePinnedToCore([](void*){ miner2.start(); }, "M2", MINER_STACK_SIZE, nullptr, THREAD_PRIORITY, nullptr, 1);
+          xTaskCreatePinnedToCore([](void*){ miner3.start(); }, "M3", MINER_STACK_SIZE, nullptr, THREAD_PRIORITY, nullptr, 0);
+          xTaskCreatePinnedToCore([](void*){ miner4.start(); }, "M4", MINER_STACK_SIZE, nullptr, THREAD_PRIORITY, nullptr, 1);
       }
     }
     
@@ -0,0 +1,65 @@
+// ============================================================================
+// bench_hex.cpp - hex codec against what it replaced
+// A 32-byte field (prevhash, merkle branch) decoded with the old
+// to_byte_array loop and with hex_decode, and encoded with sprintf("%02x")
+// and with hex_encode.
+// ============================================================================
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <chrono>
+#include "Hex.h"
+
+static const int ROUNDS = 2000000;
+
+// The former MiningCore decoder, upper case only, one branch per nibble
+static int to_byte_array(const char* in, size_t in_size, uint8_t* out) {
+    int count = 0;
+    auto nibble = [](char ch) -> uint8_t { return (ch > '9') ? (ch - 'A' + 10) : (ch - '0'); };
+    for (size_t i = 0; i + 1 < in_size && in[i]; i += 2) {
+        out[count++] = (nibble(in[i]) << 4) | nibble(in[i + 1]);
+    }
+    return count;
+}
+
+template <typename F>
+static double ns_per_call(F body) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ROUNDS; i++) body(i);
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ROUNDS;
+}
+
+int main() {
+    uint8_t bytes[32], out[32];
+    char text[65], upper[65];
+    srand(5);
+    for (int i = 0; i < 32; i++) bytes[i] = (uint8_t)rand();
+    hex_encode(bytes, 32, text);
+    for (int i = 0; i < 65; i++) upper[i] = (char)toupper((unsigned char)text[i]);
+
+    volatile uint8_t sink = 0;
+    double old_decode = ns_per_call([&](int i) {
+        upper[0] = "0123456789ABCDEF"[i & 15];
+        to_byte_array(upper, 64, out);
+        sink ^= out[0];
+    });
+    double new_decode = ns_per_call([&](int i) {
+        text[0] = "0123456789abcdef"[i & 15];
+        hex_decode(text, 64, out);
+        sink ^= out[0];
+    });
+    double old_encode = ns_per_call([&](int i) {
+        bytes[0] = (uint8_t)i;
+        for (int j = 0; j < 32; j++) sprintf(text + 2 * j, "%02x", bytes[j]);
+        sink ^= text[0];
+    });
+    double new_encode = ns_per_call([&](int i) {
+        bytes[0] = (uint8_t)i;
+        hex_encode(bytes, 32, text);
+        sink ^= text[0];
+    });
+
+    printf("32-byte field decode: to_byte_array %.1f ns, hex_decode %.1f ns\n", old_decode, new_decode);
+    printf("32-byte field encode: sprintf %.1f ns, hex_encode %.1f ns\n", old_encode, new_encode);
+    return 0;
+}
@@ -0,0 +1,45 @@
+// ============================================================================
+// bench_scan_lanes.cpp - single vs two-way interleaved scalar kernel
+// Built once per SHA256_SCAN_LANES value (bench_scan_lanes1/2); each build
+// times sha256d_scan_scalar, the kernel the device runs, in the miner's own
+// batch size so per-call setup is paid as often as on the device, and the
+// faster setting can be kept in build_flags per target.
+// ============================================================================
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include "sha256.h"
+
+static const uint32_t BATCH = 256;          // nonces per call: BATCH in BitcoinMiner::mine()
+static const uint32_t TOTAL = 1u << 23;
+
+int main() {
+    uint8_t header[80];
+    srand(11);
+    for (int i = 0; i < 80; i++) header[i] = (uint8_t)rand();
+    JobPrecompute job;
+    sha256_job_init(&job, header);
+
+    // 32 zero bits: the early exit is taken on every nonce, as when mining
+    uint8_t target32[32];
+    memset(target32, 0xFF, 32);
+    memset(target32 + 28, 0, 4);
+    ShareTarget target;
+    sha256_target_init(&target, target32);
+
+    Candidate out[4];
+    uint32_t halfshares = 0;
+    sha256d_scan_scalar(&job, &target, 0, BATCH, out, 4);  // warm up
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t nonce = 0; nonce < TOTAL; ) {
+        ScanResult res = sha256d_scan_scalar(&job, &target, nonce, BATCH, out, 4);
+        halfshares += res.halfshares;
+        nonce += res.scanned;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("scalar, %d lane%s: %.2f MH/s (%u halfshares)\n", SHA256_SCAN_LANES,
+           SHA256_SCAN_LANES == 1 ? "" : "s", TOTAL / seconds / 1e6, halfshares);
+    return 0;
+}
@@ -0,0 +1,70 @@
+// ============================================================================
+// test_hex.cpp - hex codec: both cases, rejection of bad input, round trips
+// ============================================================================
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include "Hex.h"
+#include "test_util.h"
+
+static void check_decode() {
+    uint8_t out[64];
+    CHECK(hex_decode("00ff10Ab", 8, out));
+    CHECK(out[0] == 0x00 && out[1] == 0xff && out[2] == 0x10 && out[3] == 0xab);
+
+    CHECK(!hex_decode("0g", 2, out));
+    CHECK(!hex_decode("abc", 3, out));                  // odd length
+    CHECK(!hex_decode("0 ", 2, out));
+    CHECK(!hex_decode("aaaaaaaaaaaaaaa:", 16, out));    // bad digit at the end
+
+    // Exactly the 22 hex digits decode, every other byte value is rejected
+    int accepted = 0;
+    for (int c = 0; c < 256; c++) {
+        char digits[3] = { (char)c, '0', 0 };
+        bool ok = hex_decode(digits, 2, out);
+        CHECK(ok == (isxdigit(c) != 0));
+        accepted += ok;
+    }
+    CHECK(accepted == 22);
+
+    // In place, as the stratum parser decodes coinb1
+    char field[] = "deadBEEF0102030405";
+    CHECK(hex_decode(field, 18, (uint8_t*)field));
+    CHECK((uint8_t)field[0] == 0xde && (uint8_t)field[3] == 0xef && field[8] == 0x05);
+
+    CHECK(hex_decode_exact("abcd", out, 2));
+    CHECK(!hex_decode_exact("abcdef", out, 2));
+    CHECK(!hex_decode_exact("ab", out, 2));
+}
+
+static void check_u32() {
+    uint32_t value;
+    CHECK(hex_to_u32("1d00ffff", &value) && value == 0x1d00ffff);
+    CHECK(hex_to_u32("2", &value) && value == 2);
+    CHECK(hex_to_u32("1FFFE000", &value) && value == 0x1fffe000);
+    CHECK(!hex_to_u32("", &value));
+    CHECK(!hex_to_u32("123456789", &value));
+    CHECK(!hex_to_u32("12x4", &value));
+}
+
+static void check_round_trip() {
+    uint8_t bytes[64], back[64];
+    char text[129];
+    srand(3);
+    for (int i = 0; i < 64; i++) bytes[i] = (uint8_t)rand();
+
+    hex_encode(bytes, 64, text);
+    CHECK(strlen(text) == 128);
+    for (int i = 0; i < 128; i++) CHECK(!isupper((unsigned char)text[i]));
+    CHECK(hex_decode(text, 128, back) && !memcmp(back, bytes, 64));
+
+    hex_encode(bytes, 0, text);
+    CHECK(text[0] == '\0');
+}
+
+int main() {
+    check_decode();
+    check_u32();
+    check_round_trip();
+    return report("test_hex");
+}
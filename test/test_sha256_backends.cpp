@@ -0,0 +1,115 @@
+// ============================================================================
+// test_sha256_backends.cpp - every scan backend against the reference path
+// Each backend the CPU supports scans the same nonce window (odd length,
+// wrapping past 0xFFFFFFFF, resumed through a small output buffer) and must
+// return the candidates, hashes and halfshare count that
+// sha256_final_rounds_with_nonce gives nonce by nonce.
+// ============================================================================
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "sha256.h"
+#include "test_util.h"
+
+static const uint32_t WINDOW = 300001;
+static const uint32_t START = 0xFFFFFFFFu - WINDOW / 2;
+static const int TARGETS = 6;
+
+struct Reference {
+    std::vector<uint8_t> hashes;   // WINDOW x 32 bytes
+    const uint8_t* hash(uint32_t nonce) const { return &hashes[(size_t)(nonce - START) * 32]; }
+};
+
+static void build_targets(const Reference& ref, uint8_t targets[TARGETS][32]) {
+    memset(targets[0], 0xFF, 32); memset(targets[0] + 28, 0, 4);      // 32 zero bits
+    memset(targets[1], 0xFF, 32); targets[1][31] = targets[1][30] = 0; // 16 zero bits
+    memset(targets[2], 0, 32);                                         // between the two
+    targets[2][29] = 0x01; targets[2][28] = 0x7a; targets[2][27] = 0x33;
+    memset(targets[3], 0xFF, 32); targets[3][31] = 0; targets[3][30] = 0x3f;  // under 16 bits
+
+    // A target equal to a real hash, and one just below it: the top word
+    // ties and the lower words decide
+    for (uint32_t k = 0; k < WINDOW; k++) {
+        const uint8_t* h = ref.hash(START + k);
+        if (h[31] || h[30]) continue;
+        memcpy(targets[4], h, 32);
+        memcpy(targets[5], h, 32);
+        for (int i = 0; i < 32 && targets[5][i]-- == 0; i++) {}
+        break;
+    }
+}
+
+static void check_backend(Sha256Backend backend, const JobPrecompute& job, const Reference& ref,
+                          uint8_t targets[TARGETS][32]) {
+    for (int t = 0; t < TARGETS; t++) {
+        ShareTarget target;
+        sha256_target_init(&target, targets[t]);
+
+        std::vector<uint32_t> want;
+        uint32_t want_half = 0;
+        for (uint32_t k = 0; k < WINDOW; k++) {
+            const uint8_t* h = ref.hash(START + k);
+            if (sha256_hash_meets(h, &target)) want.push_back(START + k);
+            want_half += !h[31] && !h[30];
+        }
+
+        // Three slots so long windows come back in several resumed calls
+        std::vector<uint32_t> got;
+        uint32_t got_half = 0, nonce = START, left = WINDOW;
+        int wrong_hash = 0;
+        Candidate out[3];
+        while (left) {
+            ScanResult res = sha256d_scan(&job, &target, nonce, left, out, 3);
+            for (uint32_t i = 0; i < res.found; i++) {
+                got.push_back(out[i].nonce);
+                wrong_hash += memcmp(out[i].hash, ref.hash(out[i].nonce), 32) != 0;
+            }
+            got_half += res.halfshares;
+            nonce += res.scanned;
+            left -= res.scanned;
+        }
+
+        bool ok = got == want && got_half == want_half && !wrong_hash;
+        CHECK(got == want);
+        CHECK(got_half == want_half);
+        CHECK(wrong_hash == 0);
+        printf("%-10s target %d: %zu candidates, %u halfshares %s\n",
+               sha256_backend_name(backend), t, got.size(), got_half, ok ? "ok" : "FAIL");
+    }
+}
+
+int main() {
+    uint8_t header[80];
+    srand(7);
+    for (int i = 0; i < 80; i++) header[i] = (uint8_t)rand();
+    JobPrecompute job;
+    sha256_job_init(&job, header);
+
+    Reference ref;
+    ref.hashes.resize((size_t)WINDOW * 32);
+    for (uint32_t k = 0; k < WINDOW; k++) {
+        sha256_final_rounds_with_nonce(&job, START + k, &ref.hashes[(size_t)k * 32]);
+    }
+
+    // The reference path itself must agree with a plain double hash
+    memcpy(header + 76, &START, 4);
+    uint8_t hash[32];
+    sha256_bitcoin_double(header, 80, hash);
+    CHECK(!memcmp(hash, ref.hash(START), 32));
+
+    uint8_t targets[TARGETS][32];
+    build_targets(ref, targets);
+
+    int tested = 0;
+    for (int b = SHA256_BACKEND_SCALAR; b <= SHA256_BACKEND_SHANI; b++) {
+        Sha256Backend backend = (Sha256Backend)b;
+        if (!sha256_set_backend(backend)) {
+            printf("%-10s not supported here, skipped\n", sha256_backend_name(backend));
+            continue;
+        }
+        check_backend(backend, job, ref, targets);
+        tested++;
+    }
+    CHECK(tested > 0);
+    return report("test_sha256_backends");
+}
@@ -0,0 +1,100 @@
+// ============================================================================
+// test_sha256_kat.cpp - known-answer test for the nonce kernel
+// Real mainnet headers must hash to their block hash through the per-job
+// precompute, and a scan over a nonce window around the winning nonce must
+// return exactly that nonce against the block's own target.
+// ============================================================================
+#include <stdio.h>
+#include "sha256.h"
+#include "test_util.h"
+
+struct KnownBlock {
+    const char* name;
+    const char* header;     // 80 bytes as serialized
+    const char* hash;       // block hash as explorers show it (byte-reversed)
+};
+
+static const KnownBlock BLOCKS[] = {
+    { "genesis",
+      "01000000000000000000000000000000000000000000000000000000000000000000"
+      "00003ba3edfd7a7b12b27ac72c3e67768f617fc81bc3888a51323a9fb8aa4b1e5e4a"
+      "29ab5f49ffff001d1dac2b7c",
+      "000000000019d6689c085ae165831e934ff763ae46a2a6c172b3f1b60a8ce26f" },
+    { "125552",
+      "0100000081cd02ab7e569e8bcd9317e2fe99f2de44d49ab2b8851ba4a30800000000"
+      "0000e320b6c2fffc8d750423db8b1eb942ae710e951ed797f7affc8892b0f1fc122b"
+      "c7f5d74df2b9441a42a14695",
+      "00000000000000001e8d6829a8a21adc5d38d0a473b144b6765798e61f98bd1d" },
+};
+
+// Block target from nbits, 32 bytes little-endian like ShareTarget expects
+static void nbits_target(uint32_t nbits, uint8_t* target) {
+    memset(target, 0, 32);
+    int exponent = nbits >> 24;
+    for (int i = 0; i < 3; i++) {
+        int pos = exponent - 3 + i;
+        if (pos >= 0 && pos < 32) target[pos] = (uint8_t)(nbits >> (8 * i));
+    }
+}
+
+static void check_block(const KnownBlock& block) {
+    uint8_t header[80], expected[32];
+    CHECK(unhex(block.header, header, 80));
+    CHECK(unhex(block.hash, expected, 32));
+    std::reverse(expected, expected + 32);
+
+    uint32_t nonce, nbits;
+    memcpy(&nonce, header + 76, 4);
+    memcpy(&nbits, header + 72, 4);
+
+    // Reference path: the full double hash of the whole header
+    uint8_t hash[32];
+    sha256_bitcoin_double(header, 80, hash);
+    CHECK(!memcmp(hash, expected, 32));
+
+    // Kernel path: midstate + header tail + nonce
+    JobPrecompute job;
+    sha256_job_init(&job, header);
+    CHECK(sha256_final_rounds_with_nonce(&job, nonce, hash));
+    CHECK(!memcmp(hash, expected, 32));
+
+    // Scan: the winning nonce, and only it, meets the block target
+    uint8_t target32[32];
+    nbits_target(nbits, target32);
+    ShareTarget target;
+    sha256_target_init(&target, target32);
+
+    Candidate out[4];
+    ScanResult res = sha256d_scan(&job, &target, nonce - 50000, 100000, out, 4);
+    CHECK(res.scanned == 100000);
+    CHECK(res.found == 1);
+    CHECK(res.found >= 1 && out[0].nonce == nonce && !memcmp(out[0].hash, expected, 32));
+
+    sha256_final_rounds_with_nonce(&job, nonce + 1, hash);
+    CHECK(!sha256_hash_meets(hash, &target));
+
+    printf("%-8s nonce %08lx %s\n", block.name, (unsigned long)nonce, failures ? "FAIL" : "ok");
+}
+
+// Streaming API against the double hash of "abc"
+static void check_streaming() {
+    uint8_t expected[32], hash[32];
+    CHECK(unhex("4f8b42c22dd3729b519ba6f68d2da7cc5b2d606d05daed5ad5128cc03e6c6358", expected, 32));
+
+    sha256_bitcoin_double((const uint8_t*)"abc", 3, hash);
+    CHECK(!memcmp(hash, expected, 32));
+
+    SHA256_CTX ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, (const uint8_t*)"a", 1);
+    sha256_update(&ctx, (const uint8_t*)"bc", 2);
+    sha256d_final(&ctx, hash);
+    CHECK(!memcmp(hash, expected, 32));
+}
+
+int main() {
+    printf("backend %s\n", sha256_backend_name(sha256_backend()));
+    for (const KnownBlock& block : BLOCKS) check_block(block);
+    check_streaming();
+    return report("test_sha256_kat");
+}
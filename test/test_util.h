@@ -0,0 +1,30 @@
+// ============================================================================
+// test_util.h - minimal checks shared by the host tests
+// ============================================================================
+#pragma once
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { failures++; printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); } \
+} while (0)
+
+// Test vectors only: no validation beyond the length
+static inline bool unhex(const char* in, uint8_t* out, size_t out_len) {
+    if (strlen(in) != 2 * out_len) return false;
+    for (size_t i = 0; i < out_len; i++) {
+        unsigned int byte;
+        if (sscanf(in + 2 * i, "%2x", &byte) != 1) return false;
+        out[i] = (uint8_t)byte;
+    }
+    return true;
+}
+
+static inline int report(const char* name) {
+    printf("%s: %s\n", name, failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}